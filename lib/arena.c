@@ -0,0 +1,160 @@
+/*
+ * arena.c -- allocator owning all the memory of one disc
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "mem.h"
+
+#define ARENA_ALIGN	16		// malloc() alignment on common platforms
+#define CHUNK_MIN	4096		// first chunk, doubled for every new one
+#define CHUNK_MAX	(64 * 1024)
+
+#define ALIGN(n, a)	(((n) + (a) - 1) & ~(size_t)((a) - 1))
+#define HEADER		ALIGN(sizeof(struct Chunk), ARENA_ALIGN)
+
+struct Chunk {
+	struct Chunk	*next;		// older chunk
+};
+
+/*
+ * A pool lives at the start of its first chunk, so a disc costs no
+ * separate allocation for it.
+ */
+struct Arena {
+	const struct Allocator *allocator;
+	struct Chunk	*chunk;		// newest chunk
+	char		*cur,		// free space in the newest chunk
+			*end;
+	size_t		chunk_size;	// size of the next chunk, 0 if not a pool
+};
+
+static struct Chunk *chunk_init(struct Arena *arena, size_t size)
+{
+	struct Chunk *chunk = mem_malloc(arena->allocator, size);
+
+	if (!chunk)
+		return NULL;
+	chunk->next	= arena->chunk;
+	arena->chunk	= chunk;
+	arena->cur	= (char *)chunk + HEADER;
+	arena->end	= (char *)chunk + size;
+	if (arena->chunk_size < CHUNK_MAX)
+		arena->chunk_size *= 2;
+	return chunk;
+}
+
+struct Arena *arena_init(const struct Allocator *allocator, bool pool)
+{
+	struct Arena tmp = {.allocator = mem_allocator(allocator), .chunk_size = CHUNK_MIN};
+	struct Arena *arena;
+
+	if (!pool) {
+		if ((arena = mem_calloc(tmp.allocator, sizeof(*arena))))
+			arena->allocator = tmp.allocator;
+		return arena;
+	}
+	if (!chunk_init(&tmp, tmp.chunk_size))
+		return NULL;
+	arena = (struct Arena *)tmp.cur;
+	*arena = tmp;
+	arena->cur += ALIGN(sizeof(*arena), ARENA_ALIGN);
+	return arena;
+}
+
+void arena_free(struct Arena *arena)
+{
+	const struct Allocator *allocator;
+	struct Chunk *chunk, *next;
+
+	if (!arena)
+		return;
+	allocator = arena->allocator;
+	if (!arena->chunk_size) {
+		mem_free(allocator, arena);
+		return;
+	}
+	for (chunk = arena->chunk; chunk; chunk = next) {
+		next = chunk->next;
+		mem_free(allocator, chunk);
+	}
+}
+
+bool arena_is_pool(const struct Arena *arena)
+{
+	return arena && arena->chunk_size;
+}
+
+const struct Allocator *arena_allocator(const struct Arena *arena)
+{
+	return arena ? arena->allocator : NULL;
+}
+
+static void *bump(struct Arena *arena, size_t size, size_t align)
+{
+	char *p = (char *)ALIGN((uintptr_t)arena->cur, align);
+	size_t n;
+
+	if (p > arena->end || size > (size_t)(arena->end - p)) {
+		n = arena->chunk_size;
+		while (n < HEADER + size)
+			n *= 2;
+		if (!chunk_init(arena, n))
+			return NULL;
+		p = arena->cur;
+	}
+	arena->cur = p + size;
+	return p;
+}
+
+void *arena_alloc(struct Arena *arena, size_t size)
+{
+	void *p;
+
+	if (!arena_is_pool(arena))
+		return mem_calloc(arena_allocator(arena), size);
+	if ((p = bump(arena, size, ARENA_ALIGN)))
+		memset(p, 0, size);
+	return p;
+}
+
+char *arena_strdup(struct Arena *arena, const char *s)
+{
+	size_t n;
+	char *p;
+
+	if (!arena_is_pool(arena))
+		return mem_strdup(arena_allocator(arena), s);
+	n = strlen(s) + 1;
+	if ((p = bump(arena, n, 1)))
+		memcpy(p, s, n);
+	return p;
+}
+
+void *arena_realloc(struct Arena *arena, void *ptr, size_t old, size_t size)
+{
+	void *p;
+
+	if (!arena_is_pool(arena))
+		return mem_realloc(arena_allocator(arena), ptr, size);
+	if (size <= old)
+		return ptr;
+	// the last allocation grows in place
+	if (ptr && (char *)ptr + old == arena->cur && size - old <= (size_t)(arena->end - arena->cur)) {
+		arena->cur += size - old;
+		return ptr;
+	}
+	if ((p = bump(arena, size, ARENA_ALIGN)) && old)
+		memcpy(p, ptr, old);
+	return p;
+}
+
+void arena_release(struct Arena *arena, void *ptr)
+{
+	if (!arena_is_pool(arena))
+		mem_free(arena_allocator(arena), ptr);
+}
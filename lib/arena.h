@@ -0,0 +1,34 @@
+/*
+ * arena.h -- allocator owning all the memory of one disc
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libcue.h"
+
+/*
+ * The memory of one disc.  With pool set it is a bump allocator, and
+ * arena_free() releases everything at once.  Otherwise every block is a
+ * separate allocation from allocator and must be released on its own.
+ */
+struct Arena *arena_init(const struct Allocator *allocator, bool pool);
+void arena_free(struct Arena *arena);
+bool arena_is_pool(const struct Arena *arena);
+const struct Allocator *arena_allocator(const struct Arena *arena);
+
+/*
+ * With a NULL arena these use the process-wide allocator, so the same code
+ * serves every kind of disc.
+ */
+void *arena_alloc(struct Arena *arena, size_t size);	// zeroed like calloc()
+char *arena_strdup(struct Arena *arena, const char *s);
+void *arena_realloc(struct Arena *arena, void *ptr, size_t old, size_t size);	// like realloc(), old is the current size
+void arena_release(struct Arena *arena, void *ptr);	// free ptr unless it lives in a pool
+
+#endif
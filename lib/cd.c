@@ -6,12 +6,26 @@
 	For license terms, see the file COPYING in this distribution.
 */
 
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "arena.h"
 #include "cdtext.h"
 #include "cd.h"
+#include "cpu.h"
+#include "encoding.h"
+#include "hash.h"
+#include "intern.h"
+#include "mem.h"
+#include "parser.h"
+#include "stats.h"
 #include "toc.h"
 
 enum DataType {
@@ -28,121 +42,287 @@ struct Data {
 		length;
 };
 
+#define INDEX_INLINE	2	// index 00 and 01, all most tracks have
+
 struct Track {
 	struct Data	zero_pre,	// pre-gap generated with zero data
 			file,		// track data file
 			zero_post;	// post-gap generated with zero data
 	int		mode,		// track mode
 			sub_mode,	// sub-channel mode
-			flags;		// flags
+			flags,		// flags
+			nindex,		// last index set + 1
+			nindex_ext;	// size of index_ext
 	char		*isrc;		// IRSC Code (5.22.4) 12 bytes
-	struct Cdtext	*cdtext;
-	long		index[MAXINDEX];	// indexes (in frames, 5.29.2.5) relative to start of file
+	struct Intern	*strings;	// the disc's string table
+	bool		frozen,		// part of a frozen disc, never written
+			shared;		// names, ISRC and indexes of a frozen disc, copied on the first write
+	struct Cdtext	cdtext;
+	long		index[INDEX_INLINE],	// indexes (in frames, 5.29.2.5) relative to start of file
+			*index_ext;		// indexes from INDEX_INLINE on, if any
 };
 
+/*
+ * A frozen disc is never written, so any number of threads read it without
+ * a lock.  cd_edit() makes a copy of it that borrows the frozen tracks and
+ * CD-TEXT, and keeps a reference to it as base.
+ */
 struct Cd {
+	struct Arena	*arena;		// owner of all nodes and strings
+	struct Intern	*strings;	// all strings of the disc, shared by tracks and CD-TEXT
+	struct Cd	*base;		// frozen disc the tracks may borrow from, or NULL
+	int		refs;		// cd_ref() and cd_unref(), atomic
+	bool		frozen;		// cd_freeze()
 	enum DiscMode	mode;		// disc mode
+	enum Format	format;		// of the sheet, for what indexes are relative to
+	int		ntrack,		// tracks in use
+			track_size,	// tracks allocated
+			maxtrack;	// MAXTRACK or MAXTRACK_EXTENDED
 	char		*catalog,	// Media Catalog Number (5.22.3)
 			*cdtextfile;	// Filename of CDText File
-	struct Cdtext	*cdtext;
-	struct Track	*track[MAXTRACK];
+	struct Cdtext	cdtext;
+	struct Track	*track;		// all tracks in one block, moved when it grows
 };
 
-struct Cd *cd_init(void)
+struct Cd *cd_new(const struct Allocator *allocator, bool pool)
 {
-	struct Cd *cd = calloc(1, sizeof(*cd));
+	struct Arena *arena = arena_init(allocator, pool);
+	struct Cd *cd = arena ? arena_alloc(arena, sizeof(*cd)) : NULL;
 
-	if (cd && !(cd->cdtext = cdtext_init())) {
-		free(cd);
+	if (!cd) {
+		arena_free(arena);
 		return NULL;
 	}
+	cd->arena = arena;
+	cd->refs = 1;
+	cd->format = CUE;
+	cd->maxtrack = MAXTRACK;
+	if (!(cd->strings = intern_init(arena))) {
+		arena_release(arena, cd);
+		arena_free(arena);
+		return NULL;
+	}
+	cdtext_init(&cd->cdtext, cd->strings);
 	return cd;
 }
 
+struct Cd *cd_init(void)
+{
+	return cd_new(NULL, false);
+}
+
 struct Cdtext *track_get_cdtext(const struct Track *track)
 {
-	return track ? track->cdtext : NULL;
+	return track ? (struct Cdtext *)&track->cdtext : NULL;
 }
 
-void track_free(struct Track *track)
+// release what the track refers to, the track itself is part of its Cd
+static void track_clear(struct Track *track)
 {
-	if (!track)
-		return;
-	cdtext_free(track_get_cdtext(track));
-	free(track->isrc);
-	free(track->zero_pre.name);
-	free(track->zero_post.name);
-	free(track->file.name);
-	free(track);
+	cdtext_clear(&track->cdtext);
+	if (track->shared)
+		return;		// it belongs to the frozen disc
+	intern_release(track->strings, track->isrc);
+	intern_release(track->strings, track->zero_pre.name);
+	intern_release(track->strings, track->zero_post.name);
+	intern_release(track->strings, track->file.name);
+	arena_release(intern_arena(track->strings), track->index_ext);
 }
 
 int cd_get_ntrack(const struct Cd *cd)
 {
-	int i = -1;
+	return cd ? cd->ntrack : -1;
+}
 
-	if (cd)
-		do
-			i++;
-		while (i < MAXTRACK && cd->track[i]);
-	return i;
+struct Cd *cd_ref(struct Cd *cd)
+{
+	if (!cd || cd_freeze(cd))
+		return NULL;
+	__sync_fetch_and_add(&cd->refs, 1);
+	return cd;
 }
 
-void cd_free(struct Cd* cd)
+void cd_unref(struct Cd *cd)
 {
-	int	i,
-		n = cd_get_ntrack(cd);
+	struct Arena *arena;
+	struct Cd *base;
+	int i;
 
-	if (!cd)
+	if (!cd || __sync_sub_and_fetch(&cd->refs, 1))
 		return;
-	free(cd->catalog);
-	free(cd->cdtextfile);
-	for (i = 0; i < n; i++)
-		track_free(cd->track[i]);
-	cdtext_free(cd_get_cdtext(cd));
-	free(cd);
+	base = cd->base;
+	if (arena_is_pool(cd->arena))
+		arena_free(cd->arena);
+	else {
+		intern_release(cd->strings, cd->catalog);
+		intern_release(cd->strings, cd->cdtextfile);
+		for (i = 0; i < cd->ntrack; i++)
+			track_clear(&cd->track[i]);
+		arena_release(cd->arena, cd->track);
+		cdtext_clear(&cd->cdtext);
+		intern_free(cd->strings);	// after all references are gone
+		arena = cd->arena;
+		arena_release(arena, cd);
+		arena_free(arena);
+	}
+	cd_unref(base);		// after the tracks that borrow from it
 }
 
-struct Track *track_init(void)
+void cd_free(struct Cd *cd)
 {
-	struct Track *track = malloc(sizeof(*track));
+	cd_unref(cd);
+}
 
-	if (!track)
-		fprintf(stderr, "unable to create track\n");
-	else {
-		track->zero_pre.type	= DATA_ZERO;
-		track->zero_pre.name	= NULL;
-		track->zero_pre.start	= -1;
-		track->zero_pre.length	= -1;
-
-		track->file.type	= DATA_AUDIO;
-		track->file.name	= NULL;
-		track->file.start	= -1;
-		track->file.length	= -1;
-
-		track->zero_post.type	= DATA_ZERO;
-		track->zero_post.name	= NULL;
-		track->zero_post.start	= -1;
-		track->zero_post.length	= -1;
-
-		track->mode	= MODE_AUDIO;
-		track->sub_mode	= SUB_MODE_RW;
-		track->flags	= FLAG_NONE;
-		track->isrc	= NULL;
-		if (!(track->cdtext = cdtext_init())) {
-			free(track);
-			return NULL;
-		}
+// PARSE_LAZY_TEXT spans become strings, the input may go then
+static int cd_resolve(struct Cd *cd)
+{
+	int i;
+
+	if (cdtext_resolve(&cd->cdtext))
+		return -1;
+	for (i = 0; i < cd->ntrack; i++)
+		if (cdtext_resolve(&cd->track[i].cdtext))
+			return -1;
+	return 0;
+}
+
+int cd_freeze(struct Cd *cd)
+{
+	int i;
+
+	if (cd->frozen)
+		return 0;
+	if (cd_resolve(cd))
+		return -1;
+	cd->cdtext.frozen = true;
+	for (i = 0; i < cd->ntrack; i++)
+		cd->track[i].frozen = cd->track[i].cdtext.frozen = true;
+	cd->frozen = true;
+	return 0;
+}
+
+int cd_is_frozen(const struct Cd *cd)
+{
+	return cd->frozen;
+}
+
+/*
+ * The copy has its own array of tracks, with the values of cd's and
+ * pointers to their strings, indexes and CD-TEXT: a few bytes per track.
+ * Whatever a setter changes then becomes the copy's own.
+ */
+struct Cd *cd_edit(struct Cd *cd)
+{
+	struct Cd *copy;
+	struct Track *track;
+	int i;
 
-		int i;
-		for (i = 0; i < MAXINDEX; i++)
-			track->index[i] = -1;
+	if (!cd || (!cd->frozen && 1 == cd->refs))
+		return cd;
+	if (cd_freeze(cd) || !(copy = cd_new(arena_allocator(cd->arena), arena_is_pool(cd->arena))))
+		return NULL;
+	copy->mode = cd->mode;
+	copy->format = cd->format;
+	copy->maxtrack = cd->maxtrack;
+	if ((cd->ntrack && !(copy->track = arena_alloc(copy->arena, cd->ntrack * sizeof(*track))))
+	    || (cd->catalog && !(copy->catalog = intern(copy->strings, cd->catalog)))
+	    || (cd->cdtextfile && !(copy->cdtextfile = intern(copy->strings, cd->cdtextfile)))) {
+		cd_unref(copy);
+		return NULL;
 	}
-	return track;
+	cdtext_share(&copy->cdtext, &cd->cdtext, copy->strings);
+	for (i = 0; i < cd->ntrack; i++) {
+		track = &copy->track[i];
+		*track = cd->track[i];
+		track->strings = copy->strings;
+		track->frozen = false;
+		track->shared = true;
+		cdtext_share(&track->cdtext, &cd->track[i].cdtext, copy->strings);
+	}
+	copy->ntrack = copy->track_size = cd->ntrack;
+	copy->base = cd;	// the caller's reference
+	return copy;
+}
+
+static void track_init(struct Track *track, struct Intern *strings)
+{
+	int i;
+
+	track->zero_pre.type	= DATA_ZERO;
+	track->zero_pre.name	= NULL;
+	track->zero_pre.start	= -1;
+	track->zero_pre.length	= -1;
+
+	track->file.type	= DATA_AUDIO;
+	track->file.name	= NULL;
+	track->file.start	= -1;
+	track->file.length	= -1;
+
+	track->zero_post.type	= DATA_ZERO;
+	track->zero_post.name	= NULL;
+	track->zero_post.start	= -1;
+	track->zero_post.length	= -1;
+
+	track->mode	= MODE_AUDIO;
+	track->sub_mode	= SUB_MODE_RW;
+	track->flags	= FLAG_NONE;
+	track->isrc	= NULL;
+	track->strings	= strings;
+	track->frozen	= false;
+	track->shared	= false;
+	cdtext_init(&track->cdtext, strings);
+
+	for (i = 0; i < INDEX_INLINE; i++)
+		track->index[i] = -1;
+	track->index_ext	= NULL;
+	track->nindex		= 0;
+	track->nindex_ext	= 0;
 }
 
-void cd_set_mode(struct Cd *cd, int mode)
+/*
+ * What a track borrows from a frozen disc becomes its own before the first
+ * write: only the touched track is copied, its CD-TEXT on its own write.
+ */
+static int track_own(struct Track *track)
 {
+	char *name[3] = {NULL}, *isrc = NULL;
+	long *ext = NULL;
+	struct Data *data[3] = {&track->zero_pre, &track->file, &track->zero_post};
+	int i;
+
+	if (track->frozen)
+		return -1;
+	if (!track->shared)
+		return 0;
+	for (i = 0; i < 3; i++)
+		if (data[i]->name && !(name[i] = intern(track->strings, data[i]->name)))
+			goto error;
+	if (track->isrc && !(isrc = intern(track->strings, track->isrc)))
+		goto error;
+	if (track->nindex_ext) {
+		if (!(ext = arena_alloc(intern_arena(track->strings), track->nindex_ext * sizeof(*ext))))
+			goto error;
+		memcpy(ext, track->index_ext, track->nindex_ext * sizeof(*ext));
+	}
+	for (i = 0; i < 3; i++)
+		data[i]->name = name[i];
+	track->isrc = isrc;
+	track->index_ext = ext;
+	track->shared = false;
+	return 0;
+error:
+	for (i = 0; i < 3; i++)
+		intern_release(track->strings, name[i]);
+	intern_release(track->strings, isrc);
+	return -1;
+}
+
+int cd_set_mode(struct Cd *cd, int mode)
+{
+	if (cd->frozen)
+		return -1;
 	cd->mode = mode;
+	return 0;
 }
 
 enum DiscMode cd_get_mode(const struct Cd *cd)
@@ -150,11 +330,30 @@ enum DiscMode cd_get_mode(const struct Cd *cd)
 	return cd->mode;
 }
 
-void cd_set_catalog(struct Cd *cd, char *catalog)
+int cd_set_format(struct Cd *cd, enum Format format)
+{
+	if (cd->frozen)
+		return -1;
+	cd->format = format;
+	return 0;
+}
+
+enum Format cd_get_format(const struct Cd *cd)
+{
+	return cd->format;
+}
+
+const struct Allocator *cd_get_allocator(const struct Cd *cd)
 {
-	if (cd->catalog)
-		free(cd->catalog);
-	cd->catalog = strdup(catalog);
+	return arena_allocator(cd->arena);
+}
+
+int cd_set_catalog(struct Cd *cd, const char *catalog)
+{
+	if (cd->frozen)
+		return -1;
+	intern_release(cd->strings, cd->catalog);
+	return (cd->catalog = intern(cd->strings, catalog)) ? 0 : -1;
 }
 
 char *cd_get_catalog(struct Cd *cd)
@@ -162,11 +361,12 @@ char *cd_get_catalog(struct Cd *cd)
 	return cd->catalog;
 }
 
-void cd_set_cdtextfile(struct Cd *cd, char *cdtextfile)
+int cd_set_cdtextfile(struct Cd *cd, const char *cdtextfile)
 {
-	if (cd->cdtextfile)
-		free(cd->cdtextfile);
-	cd->cdtextfile = strdup(cdtextfile);
+	if (cd->frozen)
+		return -1;
+	intern_release(cd->strings, cd->cdtextfile);
+	return (cd->cdtextfile = intern(cd->strings, cdtextfile)) ? 0 : -1;
 }
 
 const char *cd_get_cdtextfile(const struct Cd *cd)
@@ -176,36 +376,94 @@ const char *cd_get_cdtextfile(const struct Cd *cd)
 
 struct Cdtext *cd_get_cdtext(const struct Cd *cd)
 {
-	return cd ? cd->cdtext : NULL;
+	return cd ? (struct Cdtext *)&cd->cdtext : NULL;
+}
+
+int cd_set_extended(struct Cd *cd, bool extended)
+{
+	if (cd->frozen)
+		return -1;
+	cd->maxtrack = extended ? MAXTRACK_EXTENDED : MAXTRACK;
+	return 0;
 }
 
 struct Track *cd_add_track(struct Cd *cd)
 {
-	int	n = cd_get_ntrack(cd);
+	struct Track *track;
+	int size;
 
-	if (!cd)
+	if (!cd || cd->frozen)
 		return NULL;
-	if (n >= MAXTRACK) {
+	if (cd->ntrack >= cd->maxtrack) {
 		fprintf(stderr, "too many tracks\n");
-		n--;
+		track = &cd->track[cd->ntrack - 1];	// reinit last track
+		track_clear(track);
+	} else {
+		if (cd->ntrack == cd->track_size) {
+			size = cd->track_size ? 2 * cd->track_size : 8;
+			if (size > cd->maxtrack)
+				size = cd->maxtrack;
+			track = arena_realloc(cd->arena, cd->track,
+			                      cd->track_size * sizeof(*track), size * sizeof(*track));
+			if (!track) {
+				fprintf(stderr, "unable to create track\n");
+				return NULL;
+			}
+			cd->track = track;
+			cd->track_size = size;
+		}
+		track = &cd->track[cd->ntrack++];
 	}
-	free(cd->track[n]);
-	cd->track[n] = track_init();	// reinit last track if there were too many
-	return cd->track[n];
+	track_init(track, cd->strings);
+	return track;
+}
+
+int cd_remove_track(struct Cd *cd)
+{
+	if (!cd || !cd->ntrack || cd->frozen)
+		return -1;
+	track_clear(&cd->track[--cd->ntrack]);
+	return 0;
+}
+
+struct Track *cd_clear_track(struct Cd *cd, int i)
+{
+	struct Track *track = cd_get_track(cd, i);
+
+	if (track && cd->frozen)
+		return NULL;
+	if (track) {
+		track_clear(track);
+		track_init(track, cd->strings);
+	}
+	return track;
+}
+
+int cd_clear_disc(struct Cd *cd)
+{
+	if (cd->frozen)
+		return -1;
+	intern_release(cd->strings, cd->catalog);
+	intern_release(cd->strings, cd->cdtextfile);
+	cd->catalog = NULL;
+	cd->cdtextfile = NULL;
+	cdtext_clear(&cd->cdtext);
+	return 0;
 }
 
 struct Track *cd_get_track(const struct Cd *cd, int i)
 {
-	if (cd && 0 < i && i <= cd_get_ntrack(cd))
-		return cd->track[i - 1];
+	if (cd && 0 < i && i <= cd->ntrack)
+		return &cd->track[i - 1];
 	return NULL;
 }
 
-void track_set_filename(struct Track *track, char *filename)
+int track_set_filename(struct Track *track, const char *filename)
 {
-	if (track->file.name)
-		free(track->file.name);
-	track->file.name = strdup(filename);
+	if (track_own(track))
+		return -1;
+	intern_release(track->strings, track->file.name);
+	return (track->file.name = intern(track->strings, filename)) ? 0 : -1;
 }
 
 char *track_get_filename(const struct Track *track)
@@ -213,9 +471,12 @@ char *track_get_filename(const struct Track *track)
 	return track->file.name;
 }
 
-void track_set_start(struct Track *track, long start)
+int track_set_start(struct Track *track, long start)
 {
+	if (track_own(track))
+		return -1;
 	track->file.start = start;
+	return 0;
 }
 
 long track_get_start(const struct Track *track)
@@ -223,9 +484,12 @@ long track_get_start(const struct Track *track)
 	return track->file.start;
 }
 
-void track_set_length(struct Track *track, long length)
+int track_set_length(struct Track *track, long length)
 {
+	if (track_own(track))
+		return -1;
 	track->file.length = length;
+	return 0;
 }
 
 long track_get_length(const struct Track *track)
@@ -233,9 +497,12 @@ long track_get_length(const struct Track *track)
 	return track->file.length;
 }
 
-void track_set_mode(struct Track *track, enum TrackMode mode)
+int track_set_mode(struct Track *track, enum TrackMode mode)
 {
+	if (track_own(track))
+		return -1;
 	track->mode = mode;
+	return 0;
 }
 
 enum TrackMode track_get_mode(const struct Track *track)
@@ -243,9 +510,12 @@ enum TrackMode track_get_mode(const struct Track *track)
 	return track->mode;
 }
 
-void track_set_sub_mode(struct Track *track, enum TrackSubMode sub_mode)
+int track_set_sub_mode(struct Track *track, enum TrackSubMode sub_mode)
 {
+	if (track_own(track))
+		return -1;
 	track->sub_mode = sub_mode;
+	return 0;
 }
 
 enum TrackSubMode track_get_sub_mode(const struct Track *track)
@@ -253,14 +523,20 @@ enum TrackSubMode track_get_sub_mode(const struct Track *track)
 	return track->sub_mode;
 }
 
-void track_set_flag(struct Track *track, enum TrackFlag flag)
+int track_set_flag(struct Track *track, enum TrackFlag flag)
 {
+	if (track_own(track))
+		return -1;
 	track->flags |= flag;
+	return 0;
 }
 
-void track_clear_flag(struct Track *track, enum TrackFlag flag)
+int track_clear_flag(struct Track *track, enum TrackFlag flag)
 {
+	if (track_own(track))
+		return -1;
 	track->flags &= ~flag;
+	return 0;
 }
 
 int track_is_set_flag(const struct Track *track, enum TrackFlag flag)
@@ -268,9 +544,12 @@ int track_is_set_flag(const struct Track *track, enum TrackFlag flag)
 	return track->flags & flag;
 }
 
-void track_set_zero_pre(struct Track *track, long length)
+int track_set_zero_pre(struct Track *track, long length)
 {
+	if (track_own(track))
+		return -1;
 	track->zero_pre.length = length;
+	return 0;
 }
 
 long track_get_zero_pre(const struct Track *track)
@@ -278,9 +557,12 @@ long track_get_zero_pre(const struct Track *track)
 	return track->zero_pre.length;
 }
 
-void track_set_zero_post(struct Track *track, long length)
+int track_set_zero_post(struct Track *track, long length)
 {
+	if (track_own(track))
+		return -1;
 	track->zero_post.length = length;
+	return 0;
 }
 
 long track_get_zero_post(const struct Track *track)
@@ -288,11 +570,12 @@ long track_get_zero_post(const struct Track *track)
 	return track->zero_post.length;
 }
 
-void track_set_isrc(struct Track *track, char *isrc)
+int track_set_isrc(struct Track *track, const char *isrc)
 {
-	if (track->isrc)
-		free(track->isrc);
-	track->isrc = strdup(isrc);
+	if (track_own(track))
+		return -1;
+	intern_release(track->strings, track->isrc);
+	return (track->isrc = intern(track->strings, isrc)) ? 0 : -1;
 }
 
 char *track_get_isrc(const struct Track *track)
@@ -302,32 +585,68 @@ char *track_get_isrc(const struct Track *track)
 
 long track_get_index(const struct Track *track, int i)
 {
-	return (0 <= i) && (i < MAXINDEX) ? track->index[i] : -1;
+	if (0 <= i && i < INDEX_INLINE)
+		return track->index[i];
+	if (INDEX_INLINE <= i && i < INDEX_INLINE + track->nindex_ext)
+		return track->index_ext[i - INDEX_INLINE];
+	return -1;
 }
 
-int track_get_nindex(struct Track *track)
+int track_get_nindex(const struct Track *track)
 {
-	int	i,
-		n = 0;
+	return track->nindex;
+}
 
-	for (i = 0; i < MAXINDEX; i++)
-		if (track_get_index(track, i) != -1)
-			n = i + 1;
-	return n;
+// keep nindex up to date after setting index i
+static void track_count_index(struct Track *track, int i, long idx)
+{
+	if (idx != -1) {
+		if (i >= track->nindex)
+			track->nindex = i + 1;
+	} else if (i == track->nindex - 1)
+		while (track->nindex && track_get_index(track, track->nindex - 1) == -1)
+			track->nindex--;
 }
 
-void track_set_index(struct Track *track, int i, long idx)
+int track_set_index(struct Track *track, int i, long idx)
 {
-	if (i < MAXINDEX) {
+	long *ext;
+	int n;
+
+	if (i < 0 || i >= MAXINDEX) {
+		fprintf(stderr, "too many indexes\n");
+		return -1;
+	}
+	if (track_own(track))
+		return -1;
+	if (i < INDEX_INLINE) {
 		track->index[i] = idx;
-		return;
+		track_count_index(track, i, idx);
+		return 0;
 	}
-	fprintf(stderr, "too many indexes\n");
+	if ((n = i - INDEX_INLINE + 1) > track->nindex_ext) {
+		if (n < 2 * track->nindex_ext)
+			n = 2 * track->nindex_ext;
+		if (n > MAXINDEX - INDEX_INLINE)
+			n = MAXINDEX - INDEX_INLINE;
+		ext = arena_realloc(intern_arena(track->strings), track->index_ext,
+		                    track->nindex_ext * sizeof(*ext), n * sizeof(*ext));
+		if (!ext) {
+			fprintf(stderr, "unable to add index\n");
+			return -1;
+		}
+		while (track->nindex_ext < n)
+			ext[track->nindex_ext++] = -1;
+		track->index_ext = ext;
+	}
+	track->index_ext[i - INDEX_INLINE] = idx;
+	track_count_index(track, i, idx);
+	return 0;
 }
 
-void track_add_index(struct Track *track, long idx)
+int track_add_index(struct Track *track, long idx)
 {
-	track_set_index(track, track_get_nindex(track), idx);
+	return track_set_index(track, track_get_nindex(track), idx);
 }
 
 // dump cd info
@@ -346,14 +665,12 @@ static void cd_track_dump(struct Track *track)
 	printf("isrc: %s\n",		track->isrc);
 	printf("indexes: %d\n", track_get_nindex(track));
 
-	for (i = 0; i < MAXINDEX; ++i)
-		if (track->index[i] != -1)
-			printf("index %d: %ld\n", i, track->index[i]);
+	for (i = 0; i < track->nindex; ++i)
+		if (track_get_index(track, i) != -1)
+			printf("index %d: %ld\n", i, track_get_index(track, i));
 
-	if (track->cdtext) {
-		printf("cdtext:\n");
-		cdtext_dump(track->cdtext, 1);
-	}
+	printf("cdtext:\n");
+	cdtext_dump(&track->cdtext, 1);
 }
 
 void cd_dump(struct Cd *cd)
@@ -366,17 +683,62 @@ void cd_dump(struct Cd *cd)
 	printf("catalog: %s\n",		cd->catalog);
 	printf("cdtextfile: %s\n",	cd->cdtextfile);
 	printf("tracks: %d\n",		n);
-	if (cd->cdtext) {
-		printf("cdtext:\n");
-		cdtext_dump(cd->cdtext, 0);
-	}
+	printf("cdtext:\n");
+	cdtext_dump(&cd->cdtext, 0);
 
 	for (i = 0; i < n; ++i) {
 		printf("\nTrack %d Info\n", i + 1);
-		cd_track_dump(cd->track[i]);
+		cd_track_dump(&cd->track[i]);
 	}
 }
 
+static void hash_text(struct Hash *hash, const char *s)
+{
+	hash_string(hash, s, s ? strlen(s) : 0);
+}
+
+/*
+ * What the parser keeps of a sheet, in the order of the disc: quoting, line
+ * ends, comments and the order of REM lines are gone already.  Strings and
+ * spans are read as they are, so a frozen disc is not written.
+ */
+void cd_fingerprint(const struct Cd *cd, int flags, unsigned char fingerprint[16])
+{
+	const struct Track *track;
+	struct Hash hash;
+	int i, j;
+
+	hash_init(&hash);
+	hash_long(&hash, flags);
+	hash_long(&hash, cd->mode);
+	hash_text(&hash, cd->catalog);
+	if (flags & FINGERPRINT_FILENAMES)
+		hash_text(&hash, cd->cdtextfile);
+	if (flags & FINGERPRINT_CDTEXT)
+		cdtext_hash(&cd->cdtext, &hash);
+
+	hash_long(&hash, cd->ntrack);
+	for (i = 0; i < cd->ntrack; i++) {
+		track = &cd->track[i];
+		hash_long(&hash, track->mode);
+		hash_long(&hash, track->sub_mode);
+		hash_long(&hash, track->flags);
+		hash_long(&hash, track->zero_pre.length);
+		hash_long(&hash, track->file.start);
+		hash_long(&hash, track->file.length);
+		hash_long(&hash, track->zero_post.length);
+		hash_long(&hash, track->nindex);
+		for (j = 0; j < track->nindex; j++)
+			hash_long(&hash, track_get_index(track, j));
+		hash_text(&hash, track->isrc);
+		if (flags & FINGERPRINT_FILENAMES)
+			hash_text(&hash, track->file.name);
+		if (flags & FINGERPRINT_CDTEXT)
+			cdtext_hash(&track->cdtext, &hash);
+	}
+	hash_final(&hash, fingerprint);
+}
+
 enum Format cf_format_from_suffix(char *name)
 {
 	char *suffix;
@@ -391,42 +753,304 @@ enum Format cf_format_from_suffix(char *name)
 	return UNKNOWN;
 }
 
-struct Cd *cf_parse(char *name, enum Format *format)
+#define SNIFF_SIZE	4096	// bytes of a file that tell its format
+
+// keywords at the start of a line that only one of the formats has
+static const char *const cue_keywords[] = {"REM", "FLAGS", "CDTEXTFILE", "POSTGAP", NULL};
+static const char *const toc_keywords[] = {
+	"CD_DA", "CD_ROM", "CD_ROM_XA", "CD_TEXT", "LANGUAGE_MAP", "LANGUAGE",
+	"AUDIOFILE", "DATAFILE", "SILENCE", "ZERO", "START", "NO", "COPY",
+	"PRE_EMPHASIS", "TWO_CHANNEL_AUDIO", "FOUR_CHANNEL_AUDIO", NULL
+};
+
+static bool is_keyword(const char *word, size_t len, const char *const *keywords)
 {
-	FILE *fp = NULL;
-	struct Cd *cd = NULL;
+	for (; *keywords; keywords++)
+		if (strlen(*keywords) == len && !strncasecmp(word, *keywords, len))
+			return true;
+	return false;
+}
 
-	if (UNKNOWN == *format)
-		if (UNKNOWN == (*format = cf_format_from_suffix(name))) {
-			fprintf(stderr, "%s: unknown file suffix\n", name);
-			return NULL;
+/*
+ * Count the lines of the text at p that start with a keyword of one format
+ * only, or with TRACK and a number (CUE) or a mode (TOC).  Text has no
+ * control bytes but whitespace; binary if more than one in a hundred, or
+ * any NUL.
+ */
+static enum Format sniff_text(const char *p, const char *end, bool *binary)
+{
+	const char *word, *q;
+	int cue = 0, toc = 0;
+	size_t len = end - p, ncontrol;
+	bool nul;
+
+	ncontrol = kernels.count_control(p, len, &nul);
+	if ((*binary = nul || 100 * ncontrol > len))
+		return UNKNOWN;
+
+	for (; p < end; p = q + 1) {
+		while (p < end && (' ' == *p || '\t' == *p))
+			p++;
+		for (word = p; p < end && ('_' == *p || isalnum((unsigned char)*p)); p++)
+			;
+		if (is_keyword(word, p - word, cue_keywords))
+			cue++;
+		else if (is_keyword(word, p - word, toc_keywords) || (end - word >= 2 && !memcmp(word, "//", 2)))
+			toc++;
+		else if (5 == p - word && !strncasecmp(word, "TRACK", 5) && p < end && (' ' == *p || '\t' == *p)) {
+			while (p < end && (' ' == *p || '\t' == *p))
+				p++;
+			if (p < end && isdigit((unsigned char)*p))
+				cue++;
+			else if (p < end && isalpha((unsigned char)*p))
+				toc++;
 		}
+		if (!(q = memchr(p, '\n', end - p)))
+			break;
+	}
+	return cue > toc ? CUE : toc > cue ? TOC : UNKNOWN;
+}
 
-	if (!strcmp("-", name))
-		fp = stdin;
-	else if (!(fp = fopen(name, "r"))) {
-		fprintf(stderr, "%s: error opening file\n", name);
-		return NULL;
+// UTF-16 with a byte order mark is sniffed by the low bytes of its characters
+static enum Format sniff(const char *buf, size_t len, bool *binary)
+{
+	char text[SNIFF_SIZE / 2];
+	size_t i, n = 0;
+	int hi;
+
+	if (len >= 2 && (!memcmp(buf, "\xFF\xFE", 2) || !memcmp(buf, "\xFE\xFF", 2))) {
+		hi = '\xFF' == *buf;
+		for (i = 2; i + 1 < len && n < sizeof(text); i += 2)
+			text[n++] = buf[i + hi] ? 'x' : buf[i + 1 - hi];
+		return sniff_text(text, text + n, binary);
 	}
+	return sniff_text(buf, buf + (len < SNIFF_SIZE ? len : SNIFF_SIZE), binary);
+}
 
-	switch (*format) {
+enum Format cf_format_sniff(const char *buf, size_t len)
+{
+	bool binary;
+
+	return sniff(buf, len, &binary);
+}
+
+static struct Cd *cf_parse_buffer(struct Parser *parser, const char *buf, size_t len, enum Format format)
+{
+	switch (format) {
 	case CUE:
-		cd = cue_parse_file(fp);
-		break;
+		return parser_cue_buffer(parser, buf, len);
 	case TOC:
-		cd = toc_parse(fp);
-		break;
+		return parser_toc_buffer(parser, buf, len);
 	}
+	return NULL;
+}
 
-	if(stdin != fp)
-		fclose(fp);
+// all of a pipe or device, NULL if it has more than max bytes (0 for any) or on an error
+static char *read_all(const struct Allocator *allocator, int fd, size_t max, size_t *len, bool *large)
+{
+	size_t size = 64 * 1024;
+	char *buf = mem_malloc(allocator, size), *p;
+	ssize_t n;
+
+	*len = 0;
+	*large = false;
+	while (buf && (n = read(fd, buf + *len, size - *len)) > 0) {
+		if ((*len += n) > max && max) {
+			*large = true;
+			break;
+		}
+		if (*len == size) {
+			if (!(p = mem_realloc(allocator, buf, 2 * size)))
+				break;
+			buf = p;
+			size *= 2;
+		}
+	}
+	if (buf && n) {
+		mem_free(allocator, buf);
+		return NULL;
+	}
+	return buf;
+}
+
+/*
+ * The content decides between the formats, unless the caller gave one;
+ * binary data is never parsed, nor UTF-16 without PARSE_ENCODING.  Regular files are mapped, others read into
+ * memory; either up to the maximum size of parser.
+ */
+static struct Cd *cf_parse_file(struct Parser *parser, char *name, enum Format *format, enum CfError *error)
+{
+	bool given = UNKNOWN != *format, is_stdin = !strcmp("-", name), binary, large = false;
+	struct Cd *cd = NULL;
+	enum Format sniffed;
+	struct stat st;
+	char *buf = NULL;
+	void *map = MAP_FAILED;
+	size_t len = 0;
+	int fd;
+
+	if (!given)
+		*format = cf_format_from_suffix(name);
+	if ((fd = is_stdin ? STDIN_FILENO : open(name, O_RDONLY)) < 0) {
+		fprintf(stderr, "%s: error opening file\n", name);
+		*error = CF_OPEN_ERROR;
+		return NULL;
+	}
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+		len = st.st_size;
+		if (!(large = parser->max_size && len > parser->max_size)
+		    && MAP_FAILED != (map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0)))
+			posix_madvise(map, len, POSIX_MADV_SEQUENTIAL);
+	}
+	// pipe, device or empty file
+	if (MAP_FAILED == map && !large)
+		buf = read_all(parser->allocator, fd, parser->max_size, &len, &large);
+	if (!is_stdin)
+		close(fd);
+
+	if (large) {
+		fprintf(stderr, "%s: larger than %zu bytes\n", name, parser->max_size);
+		*error = CF_TOO_LARGE;
+	} else if (MAP_FAILED == map && !buf) {
+		fprintf(stderr, "%s: error reading file\n", name);
+		*error = CF_OPEN_ERROR;
+	} else if (sniffed = sniff(MAP_FAILED != map ? map : buf, len, &binary), binary) {
+		fprintf(stderr, "%s: binary data, no CUE or TOC sheet\n", name);
+		*error = CF_NOT_A_SHEET;
+	} else if (!parser_is_set_flag(parser, PARSE_ENCODING)
+		   && ENCODING_ASCII != encoding_bom(MAP_FAILED != map ? map : buf, len)) {
+		fprintf(stderr, "%s: UTF-16 sheet, parse with PARSE_ENCODING\n", name);
+		*error = CF_NOT_A_SHEET;
+	} else if (!given && UNKNOWN == (*format = UNKNOWN != sniffed ? sniffed : *format)) {
+		fprintf(stderr, "%s: unknown file format\n", name);
+		*error = CF_UNKNOWN_FORMAT;
+	} else {
+		cd = cf_parse_buffer(parser, MAP_FAILED != map ? map : buf, len, *format);
+		// spans into the file must not outlive it
+		if (cd && cd_resolve(cd)) {
+			cd_unref(cd);
+			cd = NULL;
+		}
+		*error = cd ? CF_OK : CF_PARSE_ERROR;
+	}
 
+	if (MAP_FAILED != map)
+		munmap(map, len);
+	mem_free(parser->allocator, buf);
 	return cd;
 }
 
+struct Cd *cf_parse(char *name, enum Format *format)
+{
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_cf_parse(parser, name, format);
+		parser_free(parser);
+	}
+
+	return cd;
+}
+
+struct Cd *parser_cf_parse(struct Parser *parser, char *name, enum Format *format)
+{
+	enum CfError error;
+
+	return cf_parse_file(parser, name, format, &error);
+}
+
+// files shared by the workers of cf_parse_many()
+struct Batch {
+	char		**names;
+	enum Format	*formats;
+	struct Cd	**cds;
+	enum CfError	*errors;
+	int		n,
+			next,		// next file to parse
+			nerror;		// number of files not parsed
+	struct Stats	stats;		// of the workers on their own threads
+};
+
+// parse files of a batch until there are none left, with one parser context
+static void *cf_parse_worker(void *arg)
+{
+	struct Batch	*batch	= arg;
+	struct Parser	*parser	= parser_init();
+	enum Format	format;
+	enum CfError	error;
+	int		i;
+
+	while ((i = __sync_fetch_and_add(&batch->next, 1)) < batch->n) {
+		format = batch->formats ? batch->formats[i] : UNKNOWN;
+		if (parser)
+			batch->cds[i] = cf_parse_file(parser, batch->names[i], &format, &error);
+		else {
+			fprintf(stderr, "%s: unable to create parser\n", batch->names[i]);
+			batch->cds[i] = NULL;
+			error = CF_PARSE_ERROR;
+		}
+
+		if (batch->formats)
+			batch->formats[i] = format;
+		if (batch->errors)
+			batch->errors[i] = error;
+		if (CF_OK != error)
+			__sync_fetch_and_add(&batch->nerror, 1);
+	}
+
+	parser_free(parser);
+	return NULL;
+}
+
+static void *cf_parse_thread(void *arg)
+{
+	struct Batch *batch = arg;
+
+	cf_parse_worker(batch);
+	if (stats_enabled)
+		stats_add(&batch->stats, &thread_stats);
+	return NULL;
+}
+
+/*
+ * parse n files on nthreads threads (number of online CPUs if nthreads <= 0)
+ * cds[i] receives the parsed Cd or NULL, errors[i] (if not NULL) the status
+ * and formats[i] (if not NULL) the input format like cf_parse() does
+ * returns the number of files not parsed
+ */
+int cf_parse_many(char **names, enum Format *formats, struct Cd **cds, enum CfError *errors, int n, int nthreads)
+{
+	struct Batch	batch	= {names, formats, cds, errors, n, 0, 0, {0}};
+	pthread_t	*thread	= NULL;
+	int		i,
+			nthread	= 0;
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > n)
+		nthreads = n;
+
+	// the calling thread is a worker as well
+	if (nthreads > 1 && (thread = mem_malloc(NULL, (nthreads - 1) * sizeof(*thread))))
+		for (i = 0; i < nthreads - 1; i++)
+			if (!pthread_create(&thread[nthread], NULL, cf_parse_thread, &batch))
+				nthread++;
+	cf_parse_worker(&batch);
+
+	for (i = 0; i < nthread; i++)
+		pthread_join(thread[i], NULL);
+	mem_free(NULL, thread);
+	if (stats_enabled)
+		stats_add(&thread_stats, &batch.stats);
+
+	return batch.nerror;
+}
+
 int cf_print(char *name, enum Format *format, struct Cd *cd)
 {
 	FILE *fp = NULL;
+	unsigned long start;
 
 	if (UNKNOWN == *format)
 		if (UNKNOWN == (*format = cf_format_from_suffix(name))) {
@@ -441,6 +1065,7 @@ int cf_print(char *name, enum Format *format, struct Cd *cd)
 		return -1;
 	}
 
+	start = stats_usec();
 	switch (*format) {
 	case CUE:
 		cue_print(fp, cd);
@@ -449,6 +1074,7 @@ int cf_print(char *name, enum Format *format, struct Cd *cd)
 		toc_print(fp, cd);
 		break;
 	}
+	STATS_TIME(print_usec, start);
 
 	if(stdout != fp)
 		fclose(fp);
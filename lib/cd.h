@@ -10,92 +10,52 @@
 #ifndef CD_H
 #define CD_H
 
+#include <stdbool.h>
+
 #include "libcue.h"
 
 #define MAXTRACK	99	// Red Book track limit (from 01 to 99)
+#define MAXTRACK_EXTENDED	100000	// limit with PARSE_EXTENDED, for chapter lists
 #define MAXINDEX	99	// Red Book index limit (from 00 to 98)
 #define PARSER_BUFFER	1024    // Parser buffer size
-
-/*
- * disc modes
- * DATA FORM OF MAIN DATA (5.29.2.8)
- */
-enum DiscMode {
-	MODE_CD_DA,		// CD-DA
-	MODE_CD_ROM,		// CD-ROM mode 1
-	MODE_CD_ROM_XA		// CD-ROM XA and CD-I
-};
-
-/*
- * track modes
- * 5.29.2.8 DATA FORM OF MAIN DATA
- * Table 350 - Data Block Type Codes
- */
-enum TrackMode {
-	MODE_AUDIO,		// 2352 byte block length
-	MODE_MODE1,		// 2048 byte block length
-	MODE_MODE1_RAW,		// 2352 byte block length
-	MODE_MODE2,		// 2336 byte block length
-	MODE_MODE2_FORM1,	// 2048 byte block length
-	MODE_MODE2_FORM2,	// 2324 byte block length
-	MODE_MODE2_FORM_MIX,	// 2332 byte block length
-	MODE_MODE2_RAW		// 2352 byte block length
-};
-
-/*
- * sub-channel mode
- * 5.29.2.13 Data Form of Sub-channel
- * NOTE: not sure if this applies to cue files
- */
-enum TrackSubMode {
-	SUB_MODE_RW,		/* RAW Data */
-	SUB_MODE_RW_RAW		/* PACK DATA (written R-W */
-};
-
-/*
- * track flags
- * Q Sub-channel Control Field (4.2.3.3, 5.29.2.2)
- */
-enum TrackFlag {
-	FLAG_NONE		= 0x00,	/* no flags set */
-	FLAG_PRE_EMPHASIS	= 0x01,	/* audio recorded with pre-emphasis */
-	FLAG_COPY_PERMITTED	= 0x02,	/* digital copy permitted */
-	FLAG_DATA		= 0x04,	/* data track */
-	FLAG_FOUR_CHANNEL	= 0x08,	/* 4 audio channels */
-	FLAG_SCMS		= 0x10,	/* SCMS (not Q Sub-ch.) (5.29.2.7) */
-	FLAG_ANY		= 0xff	/* any flags set */
-};
+#define PARSER_MAX_SIZE	(64 << 20)	// default limit of files cf_parse() reads
 
 // Cd functions
+struct Cd *cd_new(const struct Allocator *allocator, bool pool);	// cd_init() with allocator, all memory in one pool if set
 enum DiscMode cd_get_mode(const struct Cd *cd);
-void cd_set_mode(struct Cd *cd, int mode);
-void cd_set_catalog(struct Cd *cd, char *catalog);
+int cd_set_mode(struct Cd *cd, int mode);
+enum Format cd_get_format(const struct Cd *cd);	// CUE indexes are relative to the file, TOC ones to the track
+int cd_set_format(struct Cd *cd, enum Format format);
+const struct Allocator *cd_get_allocator(const struct Cd *cd);
+int cd_set_catalog(struct Cd *cd, const char *catalog);
 char *cd_get_catalog(struct Cd *cd);
-void cd_set_cdtextfile(struct Cd *cd, char *cdtextfile);
+int cd_set_cdtextfile(struct Cd *cd, const char *cdtextfile);
 const char *cd_get_cdtextfile(const struct Cd *cd);
 
+int cd_set_extended(struct Cd *cd, bool extended);	// allow MAXTRACK_EXTENDED tracks instead of MAXTRACK
+
 // add new track to cd, return pointer of new track
 struct Track *cd_add_track(struct Cd *cd);
+int cd_remove_track(struct Cd *cd);	// remove the last track
+struct Track *cd_clear_track(struct Cd *cd, int i);	// track i as if just added, NULL if none
+int cd_clear_disc(struct Cd *cd);	// forget catalog, CD-TEXT file and CD-TEXT, keep the tracks
 
 // Track functions
 enum TrackMode track_get_mode(const struct Track *track);
 enum TrackSubMode track_get_sub_mode(const struct Track *track);
 int track_is_set_flag(const struct Track *track, enum TrackFlag flag);
-void track_set_filename(struct Track *track, char *filename);	// filename of data file
-void track_set_start(struct Track *track, long start);		// starting position in data file
-void track_set_length(struct Track *track, long length);	// length of data file to use
-void track_set_mode(struct Track *track, enum TrackMode mode);
-void track_set_sub_mode(struct Track *track, enum TrackSubMode sub_mode);
-void track_set_flag(struct Track *track, enum TrackFlag flag);
-void track_clear_flag(struct Track *track, enum TrackFlag flag);
-
-void track_set_zero_pre(struct Track *track, long length);
-void track_set_zero_post(struct Track *track, long length);
-void track_set_isrc(struct Track *track, char *isrc);
-void track_set_index(struct Track *track, int i, long index);
-
-int track_get_nindex(struct Track *track);
-void track_add_index(struct Track *track, long idx);
+int track_set_start(struct Track *track, long start);		// starting position in data file
+int track_set_length(struct Track *track, long length);	// length of data file to use
+int track_set_mode(struct Track *track, enum TrackMode mode);
+int track_set_sub_mode(struct Track *track, enum TrackSubMode sub_mode);
+int track_set_flag(struct Track *track, enum TrackFlag flag);
+int track_clear_flag(struct Track *track, enum TrackFlag flag);
+
+int track_set_zero_pre(struct Track *track, long length);
+int track_set_zero_post(struct Track *track, long length);
+
+int track_get_nindex(const struct Track *track);
+int track_add_index(struct Track *track, long idx);
 
 void cue_print(FILE *fp, struct Cd *cd);
 
@@ -10,49 +10,211 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "cdtext.h"
+#include "intern.h"
 
-struct Cdtext *cdtext_init(void)
+#define REM_BIT(i)	(PTI_SIZE + (i))
+
+static int popcount(uint32_t x)
 {
-	return calloc(1, sizeof(struct Cdtext));
+	int n;
+
+	for (n = 0; x; n++)
+		x &= x - 1;
+	return n;
 }
 
-void cdtext_free(struct Cdtext *cdtext)
+// slot of the field with this bit in value
+static int slot(const struct Cdtext *cdtext, int bit)
 {
-	enum Pti i;
-	enum Rem j;
+	return popcount(cdtext->set & ((1u << bit) - 1));
+}
 
-	if (cdtext) {
-		for (i = PTI_TITLE; i < PTI_SIZE; i++)
-			free(cdtext->pti[i]);
-		for (j = REM_DATE; j < REM_SIZE; j++)
-			free(cdtext->rem[j]);
-		free(cdtext);
+static struct Field *field(const struct Cdtext *cdtext, int bit)
+{
+	if (!cdtext || !(cdtext->set & 1u << bit))
+		return NULL;
+	return &cdtext->field[slot(cdtext, bit)];
+}
+
+/*
+ * A span becomes a string here, the disc is logically unchanged.  Only a
+ * disc with one reference has spans: cd_ref() and cd_freeze() resolve them.
+ */
+static char *field_get(const struct Cdtext *cdtext, int bit)
+{
+	struct Field *f = field(cdtext, bit);
+	char *s;
+
+	if (!f)
+		return NULL;
+	if (f->len) {
+		if (!(s = intern_len(cdtext->strings, f->ptr, f->len)))
+			return NULL;
+		f->ptr = s;
+		f->len = 0;
 	}
+	return (char *)f->ptr;
 }
 
-bool cdtext_is_empty(struct Cdtext *cdtext)
+static const char *field_span(const struct Cdtext *cdtext, int bit, size_t *len)
 {
-	enum Pti i;
+	struct Field *f = field(cdtext, bit);
+
+	if (!f) {
+		*len = 0;
+		return NULL;
+	}
+	*len = f->len ? f->len : strlen(f->ptr);
+	return f->ptr;
+}
+
+/*
+ * Fields shared with a frozen disc become the Cdtext's own before the first
+ * write: only the touched Cdtext is copied.
+ */
+static int cdtext_own(struct Cdtext *cdtext)
+{
+	int i, n = popcount(cdtext->set);
+	struct Field *f = NULL;
+
+	if (cdtext->frozen)
+		return -1;
+	if (!cdtext->shared)
+		return 0;
+	if (n && !(f = arena_alloc(intern_arena(cdtext->strings), n * sizeof(*f))))
+		return -1;
+	for (i = 0; i < n; i++) {
+		f[i].len = 0;
+		f[i].ptr = intern_len(cdtext->strings, cdtext->field[i].ptr,
+		                      cdtext->field[i].len ? cdtext->field[i].len : strlen(cdtext->field[i].ptr));
+		if (!f[i].ptr) {
+			while (i--)
+				intern_release(cdtext->strings, (char *)f[i].ptr);
+			arena_release(intern_arena(cdtext->strings), f);
+			return -1;
+		}
+	}
+	cdtext->field = f;
+	cdtext->shared = false;
+	return 0;
+}
+
+static void field_release(struct Cdtext *cdtext, struct Field *f)
+{
+	if (!f->len)
+		intern_release(cdtext->strings, (char *)f->ptr);
+}
+
+// s is an interned string if len is 0, a span otherwise; -1 if not set
+static int field_set(struct Cdtext *cdtext, int bit, const char *s, size_t len)
+{
+	int	i = slot(cdtext, bit),
+		n = popcount(cdtext->set);
+	struct Field *f;
+
+	if (cdtext_own(cdtext)) {
+		if (!len)
+			intern_release(cdtext->strings, (char *)s);
+		return -1;
+	}
+	if (cdtext->set & 1u << bit)
+		field_release(cdtext, &cdtext->field[i]);
+	else {
+		f = arena_realloc(intern_arena(cdtext->strings), cdtext->field, n * sizeof(*f), (n + 1) * sizeof(*f));
+		if (!f) {
+			if (!len)
+				intern_release(cdtext->strings, (char *)s);
+			return -1;
+		}
+		memmove(f + i + 1, f + i, (n - i) * sizeof(*f));
+		cdtext->field = f;
+		cdtext->set |= 1u << bit;
+	}
+	cdtext->field[i].ptr = s;
+	cdtext->field[i].len = len;
+	return 0;
+}
+
+static int field_set_string(struct Cdtext *cdtext, int bit, const char *value)
+{
+	char *s;
+
+	// the string table of a frozen disc is not written either
+	if (cdtext_own(cdtext) || !(s = intern(cdtext->strings, value)))
+		return -1;
+	return field_set(cdtext, bit, s, 0);
+}
 
-	if (cdtext)
-		for (i = PTI_TITLE; i < PTI_SIZE; i++)
-			if (cdtext->pti[i])
-				return false;
-	return true;
+void cdtext_init(struct Cdtext *cdtext, struct Intern *strings)
+{
+	cdtext->strings	= strings;
+	cdtext->field	= NULL;
+	cdtext->set	= 0;
+	cdtext->frozen	= false;
+	cdtext->shared	= false;
 }
 
-void cdtext_set(struct Cdtext *cdtext, enum Pti i, char *value)
+void cdtext_clear(struct Cdtext *cdtext)
 {
-	if (value) {	// don't pass NULL to strdup
-		free(cdtext->pti[i]);
-		cdtext->pti[i] = strdup (value);
+	int i, n = popcount(cdtext->set);
+
+	// fields of a frozen disc stay with it
+	if (!cdtext->shared) {
+		for (i = 0; i < n; i++)
+			field_release(cdtext, &cdtext->field[i]);
+		arena_release(intern_arena(cdtext->strings), cdtext->field);
 	}
+	cdtext->field	= NULL;
+	cdtext->set	= 0;
+	cdtext->shared	= false;
+}
+
+// readers of a frozen disc must find strings, not spans to copy
+int cdtext_resolve(struct Cdtext *cdtext)
+{
+	int bit;
+
+	for (bit = 0; bit < PTI_SIZE + REM_SIZE; bit++)
+		if (cdtext->set & 1u << bit && !field_get(cdtext, bit))
+			return -1;
+	return 0;
+}
+
+void cdtext_share(struct Cdtext *to, const struct Cdtext *from, struct Intern *strings)
+{
+	*to = *from;
+	to->strings = strings;
+	to->frozen = false;
+	to->shared = from->set != 0;
+}
+
+bool cdtext_is_empty(struct Cdtext *cdtext)
+{
+	return !cdtext || !(cdtext->set & ((1u << PTI_SIZE) - 1));
+}
+
+int cdtext_set(struct Cdtext *cdtext, enum Pti i, const char *value)
+{
+	if (!value)	// don't pass NULL to strdup
+		return 0;
+	return field_set_string(cdtext, i, value);
+}
+
+int cdtext_set_span(struct Cdtext *cdtext, enum Pti i, const char *s, size_t len)
+{
+	return field_set(cdtext, i, s, len);
 }
 
 char *cdtext_get(const struct Cdtext *cdtext, enum Pti i)
 {
-	return !cdtext ? NULL : cdtext->pti[i];
+	return field_get(cdtext, i);
+}
+
+const char *cdtext_get_span(const struct Cdtext *cdtext, enum Pti i, size_t *len)
+{
+	return field_span(cdtext, i, len);
 }
 
 const char *cdtext_get_key(enum Pti pti, int istrack)
@@ -126,19 +288,45 @@ void cdtext_dump(struct Cdtext *cdtext, bool istrack)
 		if (value = cdtext_get(cdtext, i))
 			printf("%s: %s\n", cdtext_get_key(i, istrack), value);
 	for (j = REM_DATE; j < REM_SIZE; j++)
-		if (value = cdtext->rem[j])
+		if (value = rem_get(cdtext, j))
 			printf("REM %u: %s\n", j, value);
 }
 
-void rem_set(struct Cdtext *cdtext, enum Rem i, char *value)
+// in bit order, whatever the order of the input
+void cdtext_hash(const struct Cdtext *cdtext, struct Hash *hash)
 {
-	if (!cdtext || !value)
-		return;
-	free(cdtext->rem[i]);
-	cdtext->rem[i] = strdup(value);
+	int i, n = popcount(cdtext->set);
+	const struct Field *f;
+
+	hash_long(hash, cdtext->set);
+	for (i = 0; i < n; i++) {
+		f = &cdtext->field[i];
+		hash_string(hash, f->ptr, f->len ? f->len : strlen(f->ptr));
+	}
+}
+
+int rem_set(struct Cdtext *cdtext, enum Rem i, const char *value)
+{
+	if (!cdtext)
+		return -1;
+	if (!value)
+		return 0;
+	return field_set_string(cdtext, REM_BIT(i), value);
+}
+
+int rem_set_span(struct Cdtext *cdtext, enum Rem i, const char *s, size_t len)
+{
+	if (!cdtext)
+		return -1;
+	return field_set(cdtext, REM_BIT(i), s, len);
 }
 
 char *rem_get(struct Cdtext *cdtext, enum Rem i)
 {
-	return !cdtext ? NULL : cdtext->rem[i];
+	return field_get(cdtext, REM_BIT(i));
+}
+
+const char *rem_get_span(const struct Cdtext *cdtext, enum Rem i, size_t *len)
+{
+	return field_span(cdtext, REM_BIT(i), len);
 }
@@ -11,14 +11,41 @@
 #define CDTEXT_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
+#include "hash.h"
+#include "intern.h"
 #include "libcue.h"
 
-struct Cdtext *cdtext_init(void);					// return a pointer to a new Cdtext
-void cdtext_free(struct Cdtext *cdtext);				// release a Cdtext
+/*
+ * A field set to an interned string, or with PARSE_LAZY_TEXT to a span of
+ * the input that becomes one on the first cdtext_get() or rem_get().
+ */
+struct Field {
+	const char	*ptr;
+	size_t		len;		// of a span, 0 for a string
+};
+
+/*
+ * Part of a Track or Cd.  Only the fields set are stored, in the order of
+ * their bits in set: bit i for PTI i, bit PTI_SIZE + i for REM i.
+ */
+struct Cdtext {
+	struct Intern	*strings;	// the disc's string table
+	struct Field	*field;
+	uint32_t	set;
+	bool		frozen,		// part of a frozen disc, never written
+			shared;		// fields of a frozen disc, copied on the first write
+};
+
+void cdtext_init(struct Cdtext *cdtext, struct Intern *strings);	// init an empty Cdtext in place
+void cdtext_clear(struct Cdtext *cdtext);				// release all fields of a Cdtext
+int cdtext_resolve(struct Cdtext *cdtext);				// strings for all spans, -1 if out of memory
+void cdtext_share(struct Cdtext *to, const struct Cdtext *from, struct Intern *strings);	// to reads the fields of frozen from
 bool cdtext_is_empty(struct Cdtext *cdtext);				// returns non-0 if no CD-TEXT field set, 0 otherwise
-void cdtext_set(struct Cdtext *cdtext, enum Pti i, char *value);	// set CD-TEXT field to value for PTI pti
+int cdtext_set_span(struct Cdtext *cdtext, enum Pti i, const char *s, size_t len);	// s must outlive the disc, len > 0
 void cdtext_dump(struct Cdtext *cdtext, bool istrack);
+void cdtext_hash(const struct Cdtext *cdtext, struct Hash *hash);	// the fields set and their values
 
 /*
  * returns appropriate string for PTI pti
@@ -27,6 +54,6 @@ void cdtext_dump(struct Cdtext *cdtext, bool istrack);
  */
 const char *cdtext_get_key(enum Pti pti, int istrack);
 
-void rem_set(struct Cdtext *cdtext, enum Rem i, char *value);
+int rem_set_span(struct Cdtext *cdtext, enum Rem i, const char *s, size_t len);
 
 #endif
@@ -0,0 +1,545 @@
+/*
+ * cpu.c -- vector kernels, bound at load to the best the CPU has
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+/*
+ * Each kernel has a scalar version, the reference, and one for each
+ * instruction set it gains from.  With CUE_MULTIARCH (configure
+ * --enable-multiarch, the default) x86 versions are built for every
+ * instruction set with a target attribute and one binary runs the best on
+ * any CPU; without it only those the compiler targets are built.  NEON is
+ * part of every aarch64 CPU.  A new kernel is a field of struct Kernels, its
+ * versions go in the table below, NULL where a level has none.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(X86) && defined(CUE_MULTIARCH)
+#define HAVE_SSE2
+#define HAVE_AVX2
+#define HAVE_AVX512
+#define TARGET(isa)	__attribute__((target(isa)))
+#elif defined(X86)
+#ifdef __SSE2__
+#define HAVE_SSE2
+#endif
+#ifdef __AVX2__
+#define HAVE_AVX2
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#define HAVE_AVX512
+#endif
+#define TARGET(isa)
+#endif
+
+#include "cpu.h"
+
+#define SELFTEST_SIZE	512	// longest input of cue_cpu_selftest(), with room for any alignment
+
+static const char *skip_ascii_scalar(const char *p, const char *end)
+{
+	while (p < end && !(*p & 0x80))
+		p++;
+	return p;
+}
+
+static size_t count_control_scalar(const char *p, size_t len, bool *nul)
+{
+	const unsigned char *q = (const unsigned char *)p;
+	size_t i, n = 0;
+
+	*nul = false;
+	for (i = 0; i < len; i++) {
+		*nul |= !q[i];
+		n += (q[i] < 0x20 && (q[i] < '\t' || q[i] > '\r')) || 0x7F == q[i];
+	}
+	return n;
+}
+
+static bool is_ws(char c)
+{
+	return ' ' == c || '\t' == c || '\r' == c;
+}
+
+static const char *skip_ws_scalar(const char *p, const char *end)
+{
+	while (p < end && is_ws(*p))
+		p++;
+	return p;
+}
+
+static const char *skip_nonws_scalar(const char *p, const char *end)
+{
+	while (p < end && !is_ws(*p) && '\n' != *p)
+		p++;
+	return p;
+}
+
+#ifdef HAVE_SSE2
+TARGET("sse2")
+static const char *skip_ascii_sse2(const char *p, const char *end)
+{
+	unsigned high;
+
+	for (; end - p >= 16; p += 16)
+		if ((high = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p))))
+			return p + __builtin_ctz(high);
+	return skip_ascii_scalar(p, end);
+}
+
+TARGET("sse2")
+static size_t count_control_sse2(const char *p, size_t len, bool *nul)
+{
+	const __m128i minus = _mm_set1_epi8(-1), space = _mm_set1_epi8(0x20),
+		      tab = _mm_set1_epi8('\t' - 1), cr = _mm_set1_epi8('\r' + 1),
+		      del = _mm_set1_epi8(0x7F), zero = _mm_setzero_si128();
+	__m128i x, low, white;
+	size_t i, n = 0;
+	unsigned z = 0;
+
+	// signed bytes: from 0 to 0x1F, but from '\t' to '\r'
+	for (i = 0; len - i >= 16; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(p + i));
+		low = _mm_and_si128(_mm_cmpgt_epi8(x, minus), _mm_cmpgt_epi8(space, x));
+		white = _mm_and_si128(_mm_cmpgt_epi8(x, tab), _mm_cmpgt_epi8(cr, x));
+		n += __builtin_popcount(_mm_movemask_epi8(_mm_or_si128(_mm_andnot_si128(white, low), _mm_cmpeq_epi8(x, del))));
+		z |= _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero));
+	}
+	n += count_control_scalar(p + i, len - i, nul);
+	*nul |= z != 0;
+	return n;
+}
+
+// bit mask of the [ \t\r] bytes in the 16 at p, and the '\n' ones if nl
+TARGET("sse2")
+static unsigned block_ws_sse2(const char *p, bool nl)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)p);
+	__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+				 _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+
+	m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+	if (nl)
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+	return (unsigned)_mm_movemask_epi8(m);
+}
+
+TARGET("sse2")
+static const char *skip_ws_sse2(const char *p, const char *end)
+{
+	unsigned stop;
+
+	for (; end - p >= 16; p += 16)
+		if ((stop = ~block_ws_sse2(p, false) & 0xFFFF))
+			return p + __builtin_ctz(stop);
+	return skip_ws_scalar(p, end);
+}
+
+TARGET("sse2")
+static const char *skip_nonws_sse2(const char *p, const char *end)
+{
+	unsigned stop;
+
+	for (; end - p >= 16; p += 16)
+		if ((stop = block_ws_sse2(p, true)))
+			return p + __builtin_ctz(stop);
+	return skip_nonws_scalar(p, end);
+}
+#endif
+
+#ifdef HAVE_AVX2
+TARGET("avx2")
+static const char *skip_ascii_avx2(const char *p, const char *end)
+{
+	unsigned high;
+
+	for (; end - p >= 32; p += 32)
+		if ((high = _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)p))))
+			return p + __builtin_ctz(high);
+	return skip_ascii_scalar(p, end);
+}
+
+TARGET("avx2")
+static size_t count_control_avx2(const char *p, size_t len, bool *nul)
+{
+	const __m256i minus = _mm256_set1_epi8(-1), space = _mm256_set1_epi8(0x20),
+		      tab = _mm256_set1_epi8('\t' - 1), cr = _mm256_set1_epi8('\r' + 1),
+		      del = _mm256_set1_epi8(0x7F), zero = _mm256_setzero_si256();
+	__m256i x, low, white;
+	size_t i, n = 0;
+	unsigned z = 0;
+
+	for (i = 0; len - i >= 32; i += 32) {
+		x = _mm256_loadu_si256((const __m256i *)(p + i));
+		low = _mm256_and_si256(_mm256_cmpgt_epi8(x, minus), _mm256_cmpgt_epi8(space, x));
+		white = _mm256_and_si256(_mm256_cmpgt_epi8(x, tab), _mm256_cmpgt_epi8(cr, x));
+		n += __builtin_popcount(_mm256_movemask_epi8(_mm256_or_si256(_mm256_andnot_si256(white, low), _mm256_cmpeq_epi8(x, del))));
+		z |= _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero));
+	}
+	n += count_control_scalar(p + i, len - i, nul);
+	*nul |= z != 0;
+	return n;
+}
+
+TARGET("avx2")
+static unsigned block_ws_avx2(const char *p, bool nl)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *)p);
+	__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+				    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+
+	m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+	if (nl)
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+	return (unsigned)_mm256_movemask_epi8(m);
+}
+
+TARGET("avx2")
+static const char *skip_ws_avx2(const char *p, const char *end)
+{
+	unsigned stop;
+
+	for (; end - p >= 32; p += 32)
+		if ((stop = ~block_ws_avx2(p, false)))
+			return p + __builtin_ctz(stop);
+	return skip_ws_scalar(p, end);
+}
+
+TARGET("avx2")
+static const char *skip_nonws_avx2(const char *p, const char *end)
+{
+	unsigned stop;
+
+	for (; end - p >= 32; p += 32)
+		if ((stop = block_ws_avx2(p, true)))
+			return p + __builtin_ctz(stop);
+	return skip_nonws_scalar(p, end);
+}
+#endif
+
+#ifdef HAVE_AVX512
+TARGET("avx512f,avx512bw")
+static const char *skip_ascii_avx512(const char *p, const char *end)
+{
+	uint64_t high;
+
+	for (; end - p >= 64; p += 64)
+		if ((high = _mm512_movepi8_mask(_mm512_loadu_si512((const void *)p))))
+			return p + __builtin_ctzll(high);
+	return skip_ascii_scalar(p, end);
+}
+
+TARGET("avx512f,avx512bw")
+static size_t count_control_avx512(const char *p, size_t len, bool *nul)
+{
+	const __m512i space = _mm512_set1_epi8(0x20), tab = _mm512_set1_epi8('\t'),
+		      cr = _mm512_set1_epi8('\r'), del = _mm512_set1_epi8(0x7F);
+	__m512i x;
+	uint64_t low, white, z = 0;
+	size_t i, n = 0;
+
+	for (i = 0; len - i >= 64; i += 64) {
+		x = _mm512_loadu_si512((const void *)(p + i));
+		low = _mm512_cmplt_epu8_mask(x, space);
+		white = _mm512_cmpge_epu8_mask(x, tab) & _mm512_cmple_epu8_mask(x, cr);
+		n += __builtin_popcountll((low & ~white) | _mm512_cmpeq_epi8_mask(x, del));
+		z |= _mm512_testn_epi8_mask(x, x);
+	}
+	n += count_control_scalar(p + i, len - i, nul);
+	*nul |= z != 0;
+	return n;
+}
+
+TARGET("avx512f,avx512bw")
+static uint64_t block_ws_avx512(const char *p, bool nl)
+{
+	__m512i v = _mm512_loadu_si512((const void *)p);
+	uint64_t m = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' '))
+		   | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\t'))
+		   | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\r'));
+
+	if (nl)
+		m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n'));
+	return m;
+}
+
+TARGET("avx512f,avx512bw")
+static const char *skip_ws_avx512(const char *p, const char *end)
+{
+	uint64_t stop;
+
+	for (; end - p >= 64; p += 64)
+		if ((stop = ~block_ws_avx512(p, false)))
+			return p + __builtin_ctzll(stop);
+	return skip_ws_scalar(p, end);
+}
+
+TARGET("avx512f,avx512bw")
+static const char *skip_nonws_avx512(const char *p, const char *end)
+{
+	uint64_t stop;
+
+	for (; end - p >= 64; p += 64)
+		if ((stop = block_ws_avx512(p, true)))
+			return p + __builtin_ctzll(stop);
+	return skip_nonws_scalar(p, end);
+}
+#endif
+
+#ifdef NEON
+static const char *skip_ascii_neon(const char *p, const char *end)
+{
+	for (; end - p >= 16; p += 16)
+		if (vmaxvq_u8(vld1q_u8((const uint8_t *)p)) & 0x80)
+			break;
+	return skip_ascii_scalar(p, end);
+}
+
+static size_t count_control_neon(const char *p, size_t len, bool *nul)
+{
+	uint8x16_t x, ctl;
+	size_t i, n = 0;
+	unsigned z = 0;
+
+	for (i = 0; len - i >= 16; i += 16) {
+		x = vld1q_u8((const uint8_t *)(p + i));
+		ctl = vbicq_u8(vcltq_u8(x, vdupq_n_u8(0x20)), vandq_u8(vcgeq_u8(x, vdupq_n_u8('\t')), vcleq_u8(x, vdupq_n_u8('\r'))));
+		ctl = vorrq_u8(ctl, vceqq_u8(x, vdupq_n_u8(0x7F)));
+		n += vaddvq_u8(vshrq_n_u8(ctl, 7));
+		z |= vmaxvq_u8(vceqq_u8(x, vdupq_n_u8(0)));
+	}
+	n += count_control_scalar(p + i, len - i, nul);
+	*nul |= z != 0;
+	return n;
+}
+
+static unsigned block_ws_neon(const char *p, bool nl)
+{
+	static const uint8_t bit[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+					1, 2, 4, 8, 16, 32, 64, 128};
+	uint8x16_t v = vld1q_u8((const uint8_t *)p);
+	uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')),
+				vceqq_u8(v, vdupq_n_u8('\t')));
+
+	m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\r')));
+	if (nl)
+		m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\n')));
+	m = vandq_u8(m, vld1q_u8(bit));
+	return vaddv_u8(vget_low_u8(m)) | (unsigned)vaddv_u8(vget_high_u8(m)) << 8;
+}
+
+static const char *skip_ws_neon(const char *p, const char *end)
+{
+	unsigned stop;
+
+	for (; end - p >= 16; p += 16)
+		if ((stop = ~block_ws_neon(p, false) & 0xFFFF))
+			return p + __builtin_ctz(stop);
+	return skip_ws_scalar(p, end);
+}
+
+static const char *skip_nonws_neon(const char *p, const char *end)
+{
+	unsigned stop;
+
+	for (; end - p >= 16; p += 16)
+		if ((stop = block_ws_neon(p, true)))
+			return p + __builtin_ctz(stop);
+	return skip_nonws_scalar(p, end);
+}
+#endif
+
+// best first, the scalar one last
+static const struct Version {
+	const char	*name;
+	int		features;	// needed
+	struct Kernels	kernels;	// NULL for none of this level
+} versions[] = {
+#ifdef HAVE_AVX512
+	{"avx512", CPU_AVX512, {skip_ascii_avx512, count_control_avx512, skip_ws_avx512, skip_nonws_avx512}},
+#endif
+#ifdef HAVE_AVX2
+	{"avx2", CPU_AVX2, {skip_ascii_avx2, count_control_avx2, skip_ws_avx2, skip_nonws_avx2}},
+#endif
+#ifdef HAVE_SSE2
+	{"sse2", CPU_SSE2, {skip_ascii_sse2, count_control_sse2, skip_ws_sse2, skip_nonws_sse2}},
+#endif
+#ifdef NEON
+	{"neon", CPU_NEON, {skip_ascii_neon, count_control_neon, skip_ws_neon, skip_nonws_neon}},
+#endif
+	{"scalar", 0, {skip_ascii_scalar, count_control_scalar, skip_ws_scalar, skip_nonws_scalar}}
+};
+
+#define NVERSION	(sizeof(versions) / sizeof(versions[0]))
+
+// LIBCUE_CPU values, each with the levels below; PCLMUL came with SSE4.2
+static const struct Level {
+	const char	*name;
+	int		features;
+} levels[] = {
+	{"scalar", 0},
+	{"sse2", CPU_SSE2},
+	{"sse4.2", CPU_SSE2 | CPU_SSE42 | CPU_PCLMUL},
+	{"avx2", CPU_SSE2 | CPU_SSE42 | CPU_PCLMUL | CPU_AVX2},
+	{"avx512", CPU_SSE2 | CPU_SSE42 | CPU_PCLMUL | CPU_AVX2 | CPU_AVX512},
+	{"neon", CPU_NEON}
+};
+
+static int detected;	// of the CPU
+static int features;	// in use, detected ones LIBCUE_CPU allows
+
+// scalar until bound, for anything that runs before
+struct Kernels kernels = {skip_ascii_scalar, count_control_scalar, skip_ws_scalar, skip_nonws_scalar};
+
+static int detect(void)
+{
+	int found = 0;
+
+#if defined(X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		found |= CPU_SSE2;
+	if (__builtin_cpu_supports("sse4.2"))
+		found |= CPU_SSE42;
+	if (__builtin_cpu_supports("pclmul"))
+		found |= CPU_PCLMUL;
+	if (__builtin_cpu_supports("avx2"))
+		found |= CPU_AVX2;
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		found |= CPU_AVX512;
+#elif defined(NEON)
+	found |= CPU_NEON;
+#endif
+	return found;
+}
+
+// each kernel from the best version with no more than allowed
+static void bind(struct Kernels *k, int allowed)
+{
+	const struct Version *v;
+
+	memset(k, 0, sizeof(*k));
+	for (v = versions; v < versions + NVERSION; v++) {
+		if ((v->features & allowed) != v->features)
+			continue;
+		if (!k->skip_ascii)
+			k->skip_ascii = v->kernels.skip_ascii;
+		if (!k->count_control)
+			k->count_control = v->kernels.count_control;
+		if (!k->skip_ws)
+			k->skip_ws = v->kernels.skip_ws;
+		if (!k->skip_nonws)
+			k->skip_nonws = v->kernels.skip_nonws;
+	}
+}
+
+__attribute__((constructor))
+static void cpu_init(void)
+{
+	const char *level = getenv("LIBCUE_CPU");
+	size_t i;
+
+	features = detected = detect();
+	if (level && *level) {
+		for (i = 0; i < sizeof(levels) / sizeof(levels[0]); i++)
+			if (!strcmp(level, levels[i].name))
+				break;
+		if (i < sizeof(levels) / sizeof(levels[0]))
+			features &= levels[i].features;
+		else
+			fprintf(stderr, "LIBCUE_CPU: unknown level %s\n", level);
+	}
+	bind(&kernels, features);
+}
+
+int cue_cpu_features(void)
+{
+	return features;
+}
+
+/*
+ * random bytes, mostly ASCII letters, with control bytes, whitespace and
+ * bytes above 0x7F as often as rate in 256
+ */
+static void fill(char *buf, size_t len, unsigned *seed, int rate)
+{
+	static const char special[] = "\0\t\n\v\f\r\x01\x08\x0E\x1F\x20\x7F\x80\xFF";
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		*seed = *seed * 1103515245 + 12345;
+		if ((int)(*seed >> 16 & 0xFF) < rate)
+			buf[i] = special[(*seed >> 24) % (sizeof(special) - 1)];
+		else
+			buf[i] = 'A' + (*seed >> 24) % 26;
+	}
+}
+
+// 0 if the kernels of k give what the scalar ones give for len bytes at p
+static int differ(const struct Kernels *k, const char *p, size_t len)
+{
+	bool nul, ref_nul;
+	size_t n;
+
+	if (k->skip_ascii(p, p + len) != skip_ascii_scalar(p, p + len))
+		return 1;
+	if (k->skip_ws(p, p + len) != skip_ws_scalar(p, p + len)
+	    || k->skip_nonws(p, p + len) != skip_nonws_scalar(p, p + len))
+		return 1;
+	n = k->count_control(p, len, &nul);
+	return n != count_control_scalar(p, len, &ref_nul) || nul != ref_nul;
+}
+
+int cue_cpu_selftest(FILE *fp)
+{
+	const struct Version *v;
+	struct Kernels k;
+	char buf[SELFTEST_SIZE + 64];
+	unsigned seed = 1;
+	size_t len, off, i;
+	int rate, nfail = 0, fail;
+
+	for (v = versions; v < versions + NVERSION; v++) {
+		if ((v->features & detected) != v->features)
+			continue;
+		// its kernels, the scalar ones where it has none
+		bind(&k, v->features);
+		fail = 0;
+		for (len = 0; len <= SELFTEST_SIZE && !fail; len++)
+			for (off = 0; off < 64 && !fail; off += 7)
+				for (rate = 0; rate <= 64 && !fail; rate += 16) {
+					fill(buf + off, len, &seed, rate);
+					fail = differ(&k, buf + off, len);
+				}
+		// one byte above 0x7F, NUL or newline in ASCII, one letter in spaces, at every place
+		for (i = 0; i < SELFTEST_SIZE && !fail; i++) {
+			memset(buf, 'a', SELFTEST_SIZE);
+			buf[i] = '\x80';
+			fail = differ(&k, buf, SELFTEST_SIZE);
+			buf[i] = '\0';
+			fail |= differ(&k, buf, SELFTEST_SIZE);
+			buf[i] = '\n';
+			fail |= differ(&k, buf, SELFTEST_SIZE);
+			memset(buf, ' ', SELFTEST_SIZE);
+			buf[i] = 'a';
+			fail |= differ(&k, buf, SELFTEST_SIZE);
+		}
+		if (fail && fp)
+			fprintf(fp, "%s: differs from scalar\n", v->name);
+		nfail += fail;
+	}
+	return nfail;
+}
@@ -0,0 +1,28 @@
+/*
+ * cpu.h -- vector kernels, bound at load to the best the CPU has
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libcue.h"
+
+struct Kernels {
+	// end of the run of ASCII bytes at p
+	const char	*(*skip_ascii)(const char *p, const char *end);
+	// control bytes but whitespace, 0x7F included; nul is set if one is NUL
+	size_t		(*count_control)(const char *p, size_t len, bool *nul);
+	// end of the run of [ \t\r] bytes at p
+	const char	*(*skip_ws)(const char *p, const char *end);
+	// end of the run at p of bytes but [ \t\r\n], an unquoted name
+	const char	*(*skip_nonws)(const char *p, const char *end);
+};
+
+extern struct Kernels kernels;
+
+#endif
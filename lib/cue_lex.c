@@ -0,0 +1,404 @@
+/*
+ * cue_lex.c -- hand-written scanner for CUE memory input
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+/*
+ * Returns the same tokens as cue_scan.l, including the longest match rules
+ * of flex, but scans the input in place.  Whitespace and unquoted names are
+ * skipped a vector at a time by the kernels of cpu.c, keywords are found in
+ * a perfect hash table.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cd.h"
+#include "cdtext.h"
+#include "cpu.h"
+#include "parser.h"
+#include "cue_parse.h"
+
+int cue_scan(YYSTYPE *, void *);	// cue_scan.l
+
+#define NO_VALUE	-1	// keyword has no semantic value
+#define KEYWORD_MIN	3
+#define KEYWORD_MAX	10
+
+struct Keyword {
+	const char	*name;
+	int		len,
+			token,		// 0 for REM
+			ival;
+	enum LexState	state;		// start condition after the keyword
+};
+
+/*
+ * keywords of the INITIAL start condition, indexed by keyword_hash()
+ */
+static const struct Keyword keywords[128] = {
+	[5]	= {"CATALOG",	7, CATALOG,	NO_VALUE,		LEX_NAME},
+	[7]	= {"AUDIO",	5, AUDIO,	MODE_AUDIO,		LEX_KEEP},
+	[8]	= {"DCP",	3, DCP,		FLAG_COPY_PERMITTED,	LEX_KEEP},
+	[10]	= {"INDEX",	5, INDEX,	NO_VALUE,		LEX_KEEP},
+	[16]	= {"4CH",	3, FOUR_CH,	FLAG_FOUR_CHANNEL,	LEX_KEEP},
+	[17]	= {"FILE",	4, FFILE,	NO_VALUE,		LEX_NAME},
+	[19]	= {"MODE2/2336", 10, MODE2_2336, MODE_MODE2,		LEX_KEEP},
+	[20]	= {"UPC_EAN",	7, UPC_EAN,	PTI_UPC_ISRC,		LEX_NAME},
+	[21]	= {"PREGAP",	6, PREGAP,	NO_VALUE,		LEX_KEEP},
+	[26]	= {"AIFF",	4, AIFF,	NO_VALUE,		LEX_KEEP},
+	[33]	= {"ARRANGER",	8, ARRANGER,	PTI_ARRANGER,		LEX_NAME},
+	[39]	= {"SONGWRITER", 10, SONGWRITER, PTI_SONGWRITER,	LEX_NAME},
+	[42]	= {"SIZE_INFO",	9, SIZE_INFO,	PTI_SIZE_INFO,		LEX_NAME},
+	[44]	= {"MODE1/2048", 10, MODE1_2048, MODE_MODE1,		LEX_KEEP},
+	[47]	= {"FLAGS",	5, FLAGS,	NO_VALUE,		LEX_KEEP},
+	[48]	= {"MP3",	3, MP3,		NO_VALUE,		LEX_KEEP},
+	[50]	= {"MODE2/2048", 10, MODE2_2048, MODE_MODE2_FORM1,	LEX_KEEP},
+	[51]	= {"TRACK",	5, TRACK,	NO_VALUE,		LEX_KEEP},
+	[53]	= {"ISRC",	4, TRACK_ISRC,	NO_VALUE,		LEX_NAME},
+	[54]	= {"GENRE",	5, GENRE,	PTI_GENRE,		LEX_NAME},
+	[64]	= {"SCMS",	4, SCMS,	FLAG_SCMS,		LEX_KEEP},
+	[75]	= {"MESSAGE",	7, MESSAGE,	PTI_MESSAGE,		LEX_NAME},
+	[76]	= {"PRE",	3, PRE,		FLAG_PRE_EMPHASIS,	LEX_KEEP},
+	[83]	= {"MODE1/2352", 10, MODE1_2352, MODE_MODE1_RAW,	LEX_KEEP},
+	[84]	= {"TITLE",	5, TITLE,	PTI_TITLE,		LEX_NAME},
+	[87]	= {"MODE2/2332", 10, MODE2_2332, MODE_MODE2_FORM_MIX,	LEX_KEEP},
+	[88]	= {"MODE2/2342", 10, MODE2_2342, MODE_MODE2_FORM2,	LEX_KEEP},
+	[89]	= {"MODE2/2352", 10, MODE2_2352, MODE_MODE2_RAW,	LEX_KEEP},
+	[94]	= {"DISC_ID",	7, DISC_ID,	PTI_DISC_ID,		LEX_NAME},
+	[99]	= {"BINARY",	6, BINARY,	NO_VALUE,		LEX_KEEP},
+	[105]	= {"REM",	3, 0,		NO_VALUE,		LEX_REM},
+	[107]	= {"WAVE",	4, WAVE,	NO_VALUE,		LEX_KEEP},
+	[109]	= {"TOC_INFO1",	9, TOC_INFO1,	PTI_TOC_INFO1,		LEX_NAME},
+	[112]	= {"POSTGAP",	7, POSTGAP,	NO_VALUE,		LEX_KEEP},
+	[113]	= {"CDTEXTFILE", 10, CDTEXTFILE, NO_VALUE,		LEX_NAME},
+	[118]	= {"PERFORMER",	9, PERFORMER,	PTI_PERFORMER,		LEX_NAME},
+	[122]	= {"FLAC",	4, FLAC,	NO_VALUE,		LEX_KEEP},
+	[123]	= {"COMPOSER",	8, COMPOSER,	PTI_COMPOSER,		LEX_NAME},
+	[124]	= {"TOC_INFO2",	9, TOC_INFO2,	PTI_TOC_INFO2,		LEX_NAME},
+	[125]	= {"MOTOROLA",	8, MOTOROLA,	NO_VALUE,		LEX_KEEP},
+};
+
+/*
+ * keywords of the REM start condition
+ */
+static const struct Keyword rem_keywords[] = {
+	{"DATE",			 4, DATE,	REM_DATE,		LEX_NAME},
+	{"DISCNUMBER",			10, DISCNUMBER,	REM_DISCNUMBER,		LEX_NAME},
+	{"GENRE",			 5, GENRE0,	PTI_GENRE,		LEX_NAME},
+	{"REPLAYGAIN_ALBUM_GAIN",	21, REPLAYGAIN_ALBUM_GAIN, REM_REPLAYGAIN_ALBUM_GAIN, LEX_RPG},
+	{"REPLAYGAIN_ALBUM_PEAK",	21, REPLAYGAIN_ALBUM_PEAK, REM_REPLAYGAIN_ALBUM_PEAK, LEX_RPG},
+	{"REPLAYGAIN_TRACK_GAIN",	21, REPLAYGAIN_TRACK_GAIN, REM_REPLAYGAIN_TRACK_GAIN, LEX_RPG},
+	{"REPLAYGAIN_TRACK_PEAK",	21, REPLAYGAIN_TRACK_PEAK, REM_REPLAYGAIN_TRACK_PEAK, LEX_RPG},
+	{NULL}
+};
+
+static inline bool is_ws(char c)
+{
+	return ' ' == c || '\t' == c || '\r' == c;
+}
+
+static inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool is_keyword_char(char c)
+{
+	return (c >= 'A' && c <= 'Z') || is_digit(c) || '_' == c || '/' == c;
+}
+
+/*
+ * length of the longest quoted string at p, 0 if none
+ *
+ * A string ends at the first quote not preceded by a backslash, or at the
+ * last escaped one if there is none.
+ */
+static size_t quoted_len(const char *p, const char *end)
+{
+	const char *q = p + 1, *last = NULL;
+
+	while ((q = memchr(q, *p, end - q))) {
+		if ('\\' != q[-1])
+			return q + 1 - p;
+		last = q++;
+	}
+	return last ? last + 1 - p : 0;
+}
+
+static unsigned keyword_hash(const char *s, int len)
+{
+	const unsigned char *u = (const unsigned char *)s;
+
+	return (6 * u[(len - 1) / 2] + u[len - 2] + 15 * u[len - 1] + len) & 127;
+}
+
+/*
+ * longest keyword at p, NULL if none
+ */
+static const struct Keyword *keyword(const char *p, const char *end)
+{
+	const struct Keyword *kw;
+	int len = 0;
+
+	while (len < KEYWORD_MAX && p + len < end && is_keyword_char(p[len]))
+		len++;
+	for (; len >= KEYWORD_MIN; len--) {
+		kw = &keywords[keyword_hash(p, len)];
+		if (kw->len == len && !memcmp(kw->name, p, len))
+			return kw;
+	}
+	return NULL;
+}
+
+static const struct Keyword *rem_keyword(const char *p, const char *end)
+{
+	const struct Keyword *kw;
+
+	for (kw = rem_keywords; kw->name; kw++)
+		if (end - p >= kw->len && !memcmp(kw->name, p, kw->len))
+			return kw;
+	return NULL;
+}
+
+// ISRC/{ws}+\" trailing context
+static bool isrc_context(const char *p, const char *end)
+{
+	const char *q = kernels.skip_ws(p, end);
+
+	return q > p && q < end && '"' == *q;
+}
+
+// like atoi() on a run of digits
+static int number(const char *p, const char *end)
+{
+	long n = 0;
+
+	for (; p < end; p++)
+		n = n > (LONG_MAX - 9) / 10 ? LONG_MAX : 10 * n + (*p - '0');
+	return (int)n;
+}
+
+static int token(struct Parser *parser, const char *start, const char *end, int token)
+{
+	parser->lex_tok = start;
+	parser->lex_cur = end;
+	parser->lex_bol = '\n' == end[-1];
+	return token;
+}
+
+// end of a chunk: the next one starts in the state of a new scan, or the split is wrong
+static int chunk_end(struct Parser *parser, const char *p)
+{
+	if (p != parser->lex_stop || parser->lex_state != LEX_INITIAL || !parser->lex_bol)
+		parser->lex_error = true;
+	parser->lex_cur = p;
+	return 0;
+}
+
+int cue_lex(YYSTYPE *lval, struct Parser *parser)
+{
+	const char *p = parser->lex_cur;
+	const char *end = parser->str + parser->len;
+	const char *stop = parser->lex_stop ? parser->lex_stop : end;
+	const char *q;
+	const struct Keyword *kw;
+	size_t n;
+
+	while (p < end) {
+		unsigned char c = *p;
+
+		if (p >= stop)
+			return chunk_end(parser, p);
+
+		switch (parser->lex_state) {
+		case LEX_REM:
+			if ('\n' == c) {
+				parser->lex_state = LEX_INITIAL;
+				parser->lex_bol = true;
+				p++;
+			} else if (('D' == c || 'G' == c || 'R' == c) && (kw = rem_keyword(p, end))) {
+				parser->lex_state = kw->state;
+				lval->ival = kw->ival;
+				return token(parser, p, p + kw->len, kw->token);
+			} else {
+				// anything else up to the keyword is ignored
+				parser->lex_bol = false;
+				p++;
+			}
+			continue;
+		case LEX_RPG:
+			if (is_ws(c)) {
+				parser->lex_bol = false;
+				p = kernels.skip_ws(p, end);
+			} else if ('\n' == c) {
+				// flex echoes it, there is no rule
+				parser->lex_bol = true;
+				p++;
+			} else {
+				q = kernels.skip_nonws(p, end);
+				lval->sval = parser_string_span(parser, p, q - p);
+				parser->lex_state = LEX_SKIP;
+				return token(parser, p, q, STRING);
+			}
+			continue;
+		case LEX_SKIP:
+			if (!(q = memchr(p, '\n', end - p))) {
+				parser->lex_bol = false;
+				p = end;
+				continue;
+			}
+			parser->lex_state = LEX_INITIAL;
+			return token(parser, p, q + 1, '\n');
+		default:
+			break;
+		}
+
+		/* INITIAL and NAME */
+		if (is_ws(c)) {
+			q = kernels.skip_ws(p, end);
+			if (parser->lex_bol && q < end && '\n' == *q) {
+				// blank line
+				p = q + 1;
+			} else {
+				parser->lex_bol = false;
+				p = q;
+			}
+			continue;
+		}
+
+		if ('\n' == c) {
+			if (parser->lex_bol) {
+				// blank line
+				p++;
+				continue;
+			}
+			return token(parser, p, p + 1, '\n');
+		}
+
+		if (';' == c && (q = memchr(p, '\n', end - p))) {
+			if (parser->lex_bol) {
+				// comment line
+				p = q + 1;
+				continue;
+			}
+			return token(parser, p, q + 1, '\n');
+		}
+
+		if (LEX_NAME == parser->lex_state) {
+			q = kernels.skip_nonws(p, end);
+			if (('"' == c || '\'' == c) && (n = quoted_len(p, end)) >= (size_t)(q - p)) {
+				lval->sval = parser_string_span(parser, p + 1, n - 2);
+				q = p + n;
+			} else if (q - p == 4 && !memcmp(p, "ISRC", 4) && isrc_context(q, end)) {
+				lval->ival = PTI_UPC_ISRC;
+				return token(parser, p, q, ISRC);
+			} else {
+				lval->sval = parser_string_span(parser, p, q - p);
+			}
+			parser->lex_state = LEX_INITIAL;
+			return token(parser, p, q, STRING);
+		}
+
+		if (('"' == c || '\'' == c) && (n = quoted_len(p, end))) {
+			lval->sval = parser_string_span(parser, p + 1, n - 2);
+			return token(parser, p, p + n, STRING);
+		}
+
+		if (':' == c)
+			return token(parser, p, p + 1, ':');
+
+		if (end - p >= 3 && !memcmp(p, "\xEF\xBB\xBF", 3)) {
+			// Byte Order Mark
+			parser->lex_bol = false;
+			p += 3;
+			continue;
+		}
+
+		kw = keyword(p, end);
+		if (is_digit(c)) {
+			for (q = p + 1; q < end && is_digit(*q); q++)
+				;
+			if (!kw || kw->len <= q - p) {
+				lval->ival = number(p, q);
+				return token(parser, p, q, NUMBER);
+			}
+		}
+		if (kw) {
+			q = p + kw->len;
+			if (kw->state != LEX_KEEP)
+				parser->lex_state = kw->state;
+			if (TRACK_ISRC == kw->token && isrc_context(q, end)) {
+				lval->ival = PTI_UPC_ISRC;
+				return token(parser, p, q, ISRC);
+			}
+			if (!kw->token) {
+				// REM
+				parser->lex_bol = false;
+				p = q;
+				continue;
+			}
+			if (kw->ival != NO_VALUE)
+				lval->ival = kw->ival;
+			return token(parser, p, q, kw->token);
+		}
+
+		if (!parser->quiet)
+			fprintf(stderr, "bad character '%c' (0x%02X)\n", c, c);
+		parser->lex_bol = false;
+		p++;
+	}
+
+	parser->lex_cur = end;
+	return 0;
+}
+
+/*
+ * scan with both scanners and compare (PARSE_LEX_CHECK), return the token
+ * of the flex scanner or 0 on any difference
+ */
+int cue_lex_check(YYSTYPE *lval, struct Parser *parser)
+{
+	char sval[PARSER_BUFFER];
+	YYSTYPE fast = {0};
+	int fast_token, flex_token;
+	bool same;
+
+	fast_token = cue_lex(&fast, parser);
+	if (STRING == fast_token)
+		strcpy(sval, fast.sval);
+
+	memset(lval, 0, sizeof(*lval));
+	flex_token = cue_scan(lval, parser->cue_scanner);
+
+	if (fast_token != flex_token)
+		same = false;
+	else if (STRING == flex_token)
+		same = !strcmp(sval, lval->sval);
+	else
+		same = fast.ival == lval->ival;
+
+	if (!same) {
+		fprintf(stderr, "%d: scanners disagree: token %d, hand-written %d\n",
+			cue_yyget_lineno(parser->cue_scanner), flex_token, fast_token);
+		parser->lex_error = true;
+		return 0;
+	}
+	return flex_token;
+}
+
+// line number of the hand-written scanner
+int cue_lex_lineno(struct Parser *parser)
+{
+	const char *p = parser->str;
+	const char *end = parser->lex_cur;
+	int lineno = 1;
+
+	while (p < end && (p = memchr(p, '\n', end - p))) {
+		lineno++;
+		p++;
+	}
+	return lineno;
+}
@@ -5,46 +5,31 @@
  * For license terms, see the file COPYING in this distribution.
  */
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "cd.h"
 #include "cdtext.h"
+#include "encoding.h"
 #include "time.h"
+#include "mem.h"
+#include "parser.h"
 #include "cue_parse_prefix.h"
 
-#ifdef YY_BUF_SIZE
-#	undef YY_BUF_SIZE
-#endif
-#define YY_BUF_SIZE 16384
-
 #define YYDEBUG 1
+#define YYMALLOC(size)	mem_malloc(parser->allocator, size)	// stack growth
+#define YYFREE(ptr)	mem_free(parser->allocator, ptr)
 
-char fnamebuf[PARSER_BUFFER];
-
-extern int yylineno;
-extern FILE* yyin;
-
-static struct Cd	*cd	= NULL;
-static struct Track	*track	= NULL;
-static struct Track	*prev_track = NULL;
-static struct Cdtext	*cdtext	= NULL;
-static char *prev_filename	= NULL;	// last file in or before last track
-static char *cur_filename	= NULL;	// last file in the last track
-static char *new_filename	= NULL;	// last file in this track
-
-/* lexer interface */
-typedef struct yy_buffer_state *YY_BUFFER_STATE;
-
-int yylex(void);
-void yyerror(const char*);
-YY_BUFFER_STATE yy_scan_string(const char*);
-YY_BUFFER_STATE yy_create_buffer(FILE*, int);
-void yy_switch_to_buffer(YY_BUFFER_STATE);
-void yy_delete_buffer(YY_BUFFER_STATE);
+void yyerror(struct Parser *, const char *);
 %}
 
+%define api.pure full
+%parse-param {struct Parser *parser}
+%lex-param {struct Parser *parser}
+
 %start cuefile
 
 %union {
@@ -121,17 +106,65 @@ void yy_delete_buffer(YY_BUFFER_STATE);
 %token <ival> REPLAYGAIN_ALBUM_PEAK
 %token <ival> REPLAYGAIN_TRACK_GAIN
 %token <ival> REPLAYGAIN_TRACK_PEAK
-%%
 
-cuefile
-	: new_cd global_statements track_list
-	;
+%{
+int cue_scan(YYSTYPE *, void *);	// cue_scan.l
+int cue_lex(YYSTYPE *, struct Parser *);	// cue_lex.c
+int cue_lex_check(YYSTYPE *, struct Parser *);
+int cue_lex_lineno(struct Parser *);
+
+// the hand-written scanner only reads memory input
+static bool fast_lex(struct Parser *parser)
+{
+	return !parser->fp && parser_is_set_flag(parser, PARSE_FAST_LEX);
+}
+
+static int lex(YYSTYPE *lval, struct Parser *parser)
+{
+	if (!parser->fp && parser_is_set_flag(parser, PARSE_LEX_CHECK))
+		return cue_lex_check(lval, parser);
+	if (fast_lex(parser))
+		return cue_lex(lval, parser);
+	return cue_scan(lval, parser->cue_scanner);
+}
 
-new_cd
-	: /* empty */ {
-		cd	= cd_init();
-		cdtext	= cd_get_cdtext(cd);
+// the hand-written scanner tells where a token starts
+static void span_token(struct Spans *spans, struct Parser *parser, int token)
+{
+	if (spans->newline) {
+		spans->ntok = 0;
+		spans->newline = false;
 	}
+	if (spans->ntok < 3)
+		spans->tok[spans->ntok] = parser->lex_tok;
+	spans->ntok++;
+	spans->prev_end = spans->last_end;
+	spans->last_end = parser->lex_cur;
+	if (STRING == token) {
+		spans->string = parser->lex_tok;
+		spans->string_end = parser->lex_cur;
+	} else if ('\n' == token)
+		spans->newline = true;
+}
+
+static int yylex(YYSTYPE *lval, struct Parser *parser)
+{
+	unsigned long start = stats_usec();
+	int token = lex(lval, parser);
+
+	if (parser->spans && token)
+		span_token(parser->spans, parser, token);
+	// the end of a chunk is not the end of the input
+	if (token || !parser->lex_stop)
+		STATS_ADD(tokens, 1);
+	STATS_TIME(lex_usec, start);
+	return token;
+}
+%}
+%%
+
+cuefile
+	: global_statements track_list
 	;
 
 global_statements
@@ -140,8 +173,8 @@ global_statements
 	;
 
 global_statement
-	: CATALOG STRING '\n' { cd_set_catalog(cd, $2); }
-	| CDTEXTFILE STRING '\n' { cd_set_cdtextfile(cd, $2); }
+	: CATALOG STRING '\n' { EMIT(catalog, $2); }
+	| CDTEXTFILE STRING '\n' { EMIT(cdtextfile, $2); }
 	| cdtext
 	| rem
 	| track_data
@@ -149,16 +182,7 @@ global_statement
 	;
 
 track_data
-	: FFILE STRING file_format '\n' {
-		if (new_filename)
-			yyerror("too many files specified\n");
-		if (track && track_get_index(track, 1) == -1)
-			track_set_filename (track, $2);
-		else {
-			new_filename = strncpy(fnamebuf, $2, sizeof(fnamebuf));
-			new_filename[sizeof(fnamebuf) - 1] = '\0';
-		}
-	}
+	: FFILE STRING file_format '\n' { EMIT(file, $2, -1, -1); }
 	;
 
 track_list
@@ -167,7 +191,7 @@ track_list
 	;
 
 track
-	: new_track track_def track_statements
+	: track_def track_statements
 	;
 
 file_format
@@ -179,31 +203,8 @@ file_format
 	| FLAC
 	;
 
-new_track
-	: /*empty */ {
-		/* save previous track, to later set length */
-		prev_track = track;
-
-		track = cd_add_track(cd);
-		cdtext = track_get_cdtext(track);
-
-		cur_filename = new_filename;
-		if (cur_filename)
-			prev_filename = cur_filename;
-
-		if (!prev_filename)
-			yyerror("no file specified for track");
-		else
-			track_set_filename(track, prev_filename);
-
-		new_filename = NULL;
-	}
-	;
-
 track_def
-	: TRACK NUMBER track_mode '\n' {
-		track_set_mode(track, $3);
-	}
+	: TRACK NUMBER track_mode '\n' { EMIT(track, $2, $3, SUB_MODE_RW); }
 	;
 
 track_mode
@@ -226,38 +227,17 @@ track_statement
 	: cdtext
 	| rem
 	| FLAGS track_flags '\n'
-	| TRACK_ISRC STRING '\n' { track_set_isrc(track, $2); }
-	| PREGAP time '\n' { track_set_zero_pre(track, $2); }
-	| INDEX NUMBER time '\n' {
-		long prev_length;
-
-		/* Set previous track length if it has not been set */
-		if (prev_track && !cur_filename && track_get_length(prev_track) == -1) {
-			/* track shares file with previous track */
-			prev_length = $3 - track_get_start(prev_track);
-			track_set_length(prev_track, prev_length);
-		}
-
-		if (1 == $2) {
-			/* INDEX 01 */
-			track_set_start(track, $3);
-
-			long idx00 = track_get_index(track, 0);
-
-			if (idx00 != -1 && $3)
-				track_set_zero_pre(track, $3 - idx00);
-		}
-
-		track_set_index (track, $2, $3);
-	}
-	| POSTGAP time '\n' { track_set_zero_post(track, $2); }
+	| TRACK_ISRC STRING '\n' { EMIT(isrc, $2); }
+	| PREGAP time '\n' { EMIT(pregap, $2); }
+	| INDEX NUMBER time '\n' { EMIT(index, $2, $3); }
+	| POSTGAP time '\n' { EMIT(postgap, $2); }
 	| track_data
 	| error '\n'
 	;
 
 track_flags
 	: /* empty */
-	| track_flags track_flag { track_set_flag(track, $2); }
+	| track_flags track_flag { EMIT(flag, $2, 1); }
 	;
 
 track_flag
@@ -268,7 +248,7 @@ track_flag
 	;
 
 cdtext
-	: cdtext_item STRING '\n' { cdtext_set(cdtext, $1, $2); }
+	: cdtext_item STRING '\n' { EMIT(cdtext, $1, $2); }
 	;
 
 cdtext_item
@@ -293,8 +273,8 @@ time
 	;
 
 rem
-	: rem_item STRING '\n' { rem_set(cdtext, $1, $2); }
-	| GENRE0 STRING '\n' { cdtext_set(cdtext, $1, $2); }
+	: rem_item STRING '\n' { EMIT(rem, $1, $2); }
+	| GENRE0 STRING '\n' { EMIT(cdtext, $1, $2); }
 	;
 
 rem_item
@@ -309,50 +289,695 @@ rem_item
 
 /* lexer interface */
 
-void yyerror(const char *s)
+void yyerror(struct Parser *parser, const char *s)
 {
-	fprintf(stderr, "%d: %s\n", yylineno, s);
+	int lineno;
+
+	parser->nerror++;
+	if (parser->quiet)
+		return;
+	STATS_ADD(errors, 1);
+	if (fast_lex(parser) && !parser_is_set_flag(parser, PARSE_LEX_CHECK))
+		lineno = cue_lex_lineno(parser);
+	else
+		lineno = cue_yyget_lineno(parser->cue_scanner);
+	fprintf(stderr, "%d: %s\n", lineno, s);
 }
 
-static void reset_static_vars()
+/* struct Cd builder */
+
+static int build_file(void *data, const char *name, long start, long length)
 {
-	cd		= NULL;
-	track		= NULL;
-	prev_track	= NULL;
-	cdtext		= NULL;
-	prev_filename	= NULL;
-	cur_filename	= NULL;
-	new_filename	= NULL;
+	struct Parser *parser = data;
+
+	if (parser->new_filename)
+		yyerror(parser, "too many files specified\n");
+	if (parser->track && track_get_index(parser->track, 1) == -1)
+		track_set_filename(parser->track, name);
+	else {
+		parser->new_filename = strncpy(parser->fnamebuf, name, sizeof(parser->fnamebuf));
+		parser->new_filename[sizeof(parser->fnamebuf) - 1] = '\0';
+	}
+	return 0;
 }
 
-struct Cd *cue_parse_file(FILE *fp)
+static int build_track(void *data, int number, enum TrackMode mode, enum TrackSubMode sub_mode)
+{
+	struct Parser *parser = data;
+	int n = parser->reuse_track ? parser->reuse_track - 1 : cd_get_ntrack(parser->cd);
+
+	// the last track wanted is complete without an index of this one
+	if (!parser->last_track || (parser->last_track > 0 && n > parser->last_track)) {
+		cd_remove_track(parser->cd);
+		parser->done = true;
+		return 0;
+	}
+	if (parser->reuse_track)
+		parser->track = cd_clear_track(parser->cd, parser->reuse_track);
+	else
+		parser->track = cd_add_track(parser->cd);
+	parser->reuse_track = 0;
+	/* previous track, to later set length; adding may have moved it */
+	parser->prev_track = cd_get_track(parser->cd, n);
+	parser->cdtext = track_get_cdtext(parser->track);
+
+	parser->cur_filename = parser->new_filename;
+	if (parser->cur_filename)
+		parser->prev_filename = parser->cur_filename;
+
+	if (!parser->prev_filename)
+		yyerror(parser, "no file specified for track");
+	else
+		track_set_filename(parser->track, parser->prev_filename);
+
+	parser->new_filename = NULL;
+
+	track_set_mode(parser->track, mode);
+	return 0;
+}
+
+static int build_index(void *data, int i, long index)
+{
+	struct Parser *parser = data;
+	long prev_length;
+
+	/* Set previous track length if it has not been set */
+	if (parser->prev_track && !parser->cur_filename
+	    && track_get_length(parser->prev_track) == -1) {
+		/* track shares file with previous track */
+		prev_length = index - track_get_start(parser->prev_track);
+		track_set_length(parser->prev_track, prev_length);
+	}
+
+	if (1 == i) {
+		/* INDEX 01 */
+		track_set_start(parser->track, index);
+
+		long idx00 = track_get_index(parser->track, 0);
+
+		if (idx00 != -1 && index)
+			track_set_zero_pre(parser->track, index - idx00);
+	}
+
+	track_set_index(parser->track, i, index);
+
+	// the first index of the track after the last one wanted ends its length
+	if (parser->last_track > 0 && cd_get_ntrack(parser->cd) > parser->last_track) {
+		cd_remove_track(parser->cd);
+		parser->done = true;
+	}
+	return 0;
+}
+
+static const struct ParseEvents build = {
+	.catalog	= build_catalog,
+	.cdtextfile	= build_cdtextfile,
+	.track		= build_track,
+	.flag		= build_flag,
+	.isrc		= build_isrc,
+	.file		= build_file,
+	.pregap		= build_pregap,
+	.index		= build_index,
+	.postgap	= build_postgap,
+	.cdtext		= build_cdtext,
+	.rem		= build_rem
+};
+
+static int parse(struct Parser *parser, const struct ParseEvents *events, void *data)
+{
+	unsigned long start = stats_usec(), lex = thread_stats.lex_usec;
+	int status = 0;
+
+	parser->events	= events;
+	parser->data	= data;
+	if (yyparse(parser) || parser->lex_error || (parser->quiet && parser->nerror))
+		status = parser->status ? parser->status : -1;
+	// leave out the time in the scanner, it has its own counter
+	STATS_TIME(parse_usec, start + (thread_stats.lex_usec - lex));
+	// flex input goes through parser_read(), which counts it
+	if (fast_lex(parser) && !parser_is_set_flag(parser, PARSE_LEX_CHECK))
+		STATS_ADD(bytes, parser->lex_cur - parser->str);
+
+	parser_reset(parser);
+
+	return status;
+}
+
+static struct Cd *parse_cd(struct Parser *parser)
+{
+	struct Cd *cd = parser_cd_init(parser);
+
+	if (!cd) {
+		parser_reset(parser);
+		return NULL;
+	}
+	if (parse(parser, &build, parser)) {
+		cd_free(cd);
+		return NULL;
+	}
+
+	return cd;
+}
+
+struct Cd *parser_cue_file(struct Parser *parser, FILE *fp)
+{
+	parser_input_file(parser, fp);
+
+	return parse_cd(parser);
+}
+
+/* parallel parse of one sheet (PARSE_PARALLEL) */
+
+#define CHUNK_MIN	(64 * 1024)	// smallest part worth a thread
+
+/*
+ * A part of the input from a TRACK line to the next part, parsed into an
+ * event log.  Its scanner reads on to the end of the input, so a token
+ * across the stop is scanned as in one parse and the stop is found to be
+ * no line start.
+ */
+struct Chunk {
+	struct Parser	*parser;
+	const char	*start,
+			*stop,		// start of the next chunk, NULL for the last
+			*end;		// end of input
+	enum Encoding	encoding;	// of all the input, not guessed from the part
+	struct EventLog	log;
+	int		status;
+	bool		thread;		// parsed on a thread of its own
+	struct Stats	*stats;		// of the threads, shared
+};
+
+static void *parse_chunk(void *arg)
+{
+	struct Chunk *chunk = arg;
+	struct Parser *parser = chunk->parser;
+
+	parser_input_buffer(parser, chunk->start, chunk->end - chunk->start);
+	parser_set_encoding(parser, chunk->encoding);
+	parser->lex_stop = chunk->stop;
+	parser->quiet = true;
+	chunk->status = parse(parser, &event_log_record, &chunk->log);
+	return NULL;
+}
+
+static void *parse_chunk_thread(void *arg)
+{
+	struct Chunk *chunk = arg;
+
+	parse_chunk(chunk);
+	if (stats_enabled)
+		stats_add(chunk->stats, &thread_stats);
+	return NULL;
+}
+
+// the line at p begins with TRACK
+static bool is_track_line(const char *p, const char *end)
+{
+	for (; p < end && (' ' == *p || '\t' == *p || '\r' == *p); p++)
+		;
+	return end - p > 5 && !memcmp(p, "TRACK", 5) && (' ' == p[5] || '\t' == p[5]);
+}
+
+// start of the first line after the one at p that begins with TRACK, NULL if none
+static const char *track_line(const char *p, const char *end)
+{
+	while ((p = memchr(p, '\n', end - p)) && ++p < end)
+		if (is_track_line(p, end))
+			return p;
+	return NULL;
+}
+
+/*
+ * Parse the chunks on threads, then replay their events in order through
+ * the builder, which carries files and lengths from track to track as in
+ * one parse.  NULL if the input is too small or anything went wrong.
+ */
+static struct Cd *parse_parallel(struct Parser *parser, const char *buf, size_t len)
 {
-	YY_BUFFER_STATE buffer = NULL;
-	yyin = fp;
-	buffer = yy_create_buffer(yyin, YY_BUF_SIZE);
-	yy_switch_to_buffer(buffer);
-	struct Cd *ret_cd = NULL;
+	const struct Allocator *allocator = parser->allocator;
+	const char *end = buf + len, *p;
+	struct Chunk *chunk;
+	struct Stats stats = {0};
+	pthread_t *thread;
+	struct Cd *cd = NULL;
+	enum Encoding encoding;
+	int i, n = 1, status = 0,
+	    nchunk = parser->nthread > 0 ? parser->nthread : sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (!parser_is_set_flag(parser, PARSE_PARALLEL) || !parser_is_set_flag(parser, PARSE_FAST_LEX)
+	    || parser_is_set_flag(parser, PARSE_LEX_CHECK) || parser->last_track >= 0)
+		return NULL;
+	// UTF-16 is converted as a whole, not in chunks
+	if (parser_is_set_flag(parser, PARSE_ENCODING) && ENCODING_ASCII != encoding_bom(buf, len))
+		return NULL;
+	if (nchunk > len / CHUNK_MIN)
+		nchunk = len / CHUNK_MIN;
+	if (nchunk < 2)
+		return NULL;
+	if (!(chunk = mem_calloc(allocator, nchunk * sizeof(*chunk)))
+	    || !(thread = mem_malloc(allocator, nchunk * sizeof(*thread)))) {
+		mem_free(allocator, chunk);
+		return NULL;
+	}
+
+	// split near equal parts
+	chunk[0].start = buf;
+	for (i = 1; i < nchunk; i++) {
+		p = buf + len / nchunk * i;
+		if (p < chunk[n - 1].start)
+			p = chunk[n - 1].start;
+		if (!(p = track_line(p, end)))
+			break;
+		chunk[n++].start = p;
+	}
+
+	// once for all chunks, a guess from one part may differ
+	encoding = parser_guess_encoding(parser, buf, len);
+	for (i = 0; i < n; i++) {
+		chunk[i].stop = i + 1 < n ? chunk[i + 1].start : NULL;
+		chunk[i].end = end;
+		chunk[i].encoding = encoding;
+		chunk[i].stats = &stats;
+		if (!(chunk[i].parser = i ? parser_init_allocator(allocator) : parser))
+			status = -1;
+		else
+			chunk[i].parser->flags = parser->flags;
+		event_log_init(&chunk[i].log, chunk[i].parser);
+	}
+
+	// the calling thread parses the first chunk, and any without a thread
+	for (i = 1; i < n && !status; i++)
+		chunk[i].thread = !pthread_create(&thread[i], NULL, parse_chunk_thread, &chunk[i]);
+	for (i = 0; i < n && !status; i++)
+		if (!chunk[i].thread)
+			parse_chunk(&chunk[i]);
+	for (i = 1; i < n; i++)
+		if (chunk[i].thread)
+			pthread_join(thread[i], NULL);
+	if (stats_enabled)
+		stats_add(&thread_stats, &stats);
+
+	for (i = 0; i < n; i++)
+		status |= chunk[i].status;
+	if (!status && (cd = parser_cd_init(parser))) {
+		parser->quiet = true;
+		for (i = 0; i < n && !status; i++)
+			status = event_log_replay(&chunk[i].log, parser, &build, parser);
+		if (status || parser->nerror) {
+			cd_free(cd);
+			cd = NULL;
+		}
+	}
+	parser_reset(parser);
+
+	for (i = 0; i < n; i++) {
+		if (chunk[i].parser)
+			event_log_free(&chunk[i].log);
+		if (i)
+			parser_free(chunk[i].parser);
+	}
+	mem_free(allocator, thread);
+	mem_free(allocator, chunk);
+	return cd;
+}
+
+struct Cd *parser_cue_buffer(struct Parser *parser, const char *buf, size_t len)
+{
+	struct Cd *cd;
+
+	// a sheet with errors is parsed again, to report them in order
+	if ((cd = parse_parallel(parser, buf, len)))
+		return cd;
+	parser_input_buffer(parser, buf, len);
+
+	return parse_cd(parser);
+}
+
+struct Cd *parser_cue_string(struct Parser *parser, const char *string)
+{
+	return parser_cue_buffer(parser, string, strlen(string));
+}
+
+int parser_cue_file_events(struct Parser *parser, FILE *fp, const struct ParseEvents *events, void *data)
+{
+	parser_input_file(parser, fp);
+
+	return parse(parser, events, data);
+}
+
+int parser_cue_buffer_events(struct Parser *parser, const char *buf, size_t len, const struct ParseEvents *events, void *data)
+{
+	parser_input_buffer(parser, buf, len);
+
+	return parse(parser, events, data);
+}
+
+/* CUE sheet kept for editing (parser_cue_document()) */
+
+// the text of a track from its TRACK line to the next, the first with the global statements
+struct Region {
+	size_t		start;		// offset in the text
+	struct EventLog	log;		// all strings copied, the text changes
+	bool		prev,		// builder state after the region: a file for the next track,
+			new;		// named after the last index of this one
+	char		*file;		// the name, NULL without either
+};
+
+struct Document {
+	const struct Allocator *allocator;
+	struct Parser	*parser;	// of its own
+	char		*text;		// NUL terminated
+	size_t		len,
+			size;
+	struct Cd	*cd;
+	enum Encoding	encoding;	// of its strings, guessed from all the text
+	struct Region	*region;	// one per track, none if the text is parsed in one piece
+	int		nregion,
+			region_size;
+};
+
+static void document_clear(struct Document *doc)
+{
+	int i;
+
+	for (i = 0; i < doc->nregion; i++) {
+		event_log_free(&doc->region[i].log);
+		mem_free(doc->allocator, doc->region[i].file);
+	}
+	doc->nregion = 0;
+	cd_free(doc->cd);
+	doc->cd = NULL;
+}
+
+// region i of the text, return 0 if it has the statements of one track
+static int region_parse(struct Document *doc, int i)
+{
+	struct Chunk chunk = {0};
+	struct EventLog *log = &doc->region[i].log;
+	size_t n, ntrack = 0;
+
+	chunk.parser = doc->parser;
+	chunk.encoding = doc->encoding;
+	chunk.start = doc->text + doc->region[i].start;
+	chunk.stop = i + 1 < doc->nregion ? doc->text + doc->region[i + 1].start : NULL;
+	chunk.end = doc->text + doc->len;
+	event_log_init(&chunk.log, doc->parser);
+	chunk.log.copy = true;
+	parse_chunk(&chunk);
+
+	event_log_free(log);
+	*log = chunk.log;
+	for (n = 0; n < log->nevent; n++)
+		ntrack += EVENT_TRACK == log->event[n].type;
+	return chunk.status || 1 != ntrack || (i && EVENT_TRACK != log->event[0].type) ? -1 : 0;
+}
+
+/*
+ * Replay region i through the builder in the state the region before left
+ * it, on the track of the region if reuse, else on a new one.  Return 1 if
+ * the next track starts with another file than before, -1 on an error.
+ */
+static int region_replay(struct Document *doc, int i, bool reuse)
+{
+	struct Parser *parser = doc->parser;
+	struct Region *region = &doc->region[i], *prev = i ? region - 1 : NULL;
+	char *file;
+
+	parser_reset(parser);
+	parser->quiet = true;
+	parser->cd = doc->cd;
+	parser->cdtext = cd_get_cdtext(doc->cd);
+	parser->reuse_track = reuse ? i + 1 : 0;
+	if (!prev && reuse)
+		cd_clear_disc(doc->cd);
+	else if (prev && prev->file) {
+		strcpy(parser->fnamebuf, prev->file);
+		parser->prev_filename = prev->prev ? parser->fnamebuf : NULL;
+		parser->new_filename = prev->new ? parser->fnamebuf : NULL;
+	}
+	if (event_log_replay(&region->log, parser, &build, parser) || parser->nerror)
+		return -1;
+
+	file = parser->prev_filename || parser->new_filename ? parser->fnamebuf : NULL;
+	if (region->prev == !!parser->prev_filename && region->new == !!parser->new_filename
+	    && !file == !region->file && (!file || !strcmp(file, region->file)))
+		return 0;
+	mem_free(doc->allocator, region->file);
+	region->prev = parser->prev_filename;
+	region->new = parser->new_filename;
+	if (file && !(region->file = mem_strdup(doc->allocator, file)))
+		return -1;
+	if (!file)
+		region->file = NULL;
+	return 1;
+}
+
+// the length of the track of region i, from the first index of the next one as in build_index()
+static void region_length(struct Document *doc, int i)
+{
+	struct Track *track = cd_get_track(doc->cd, i + 1);
+	const struct EventLog *log;
+	size_t n;
+
+	track_set_length(track, -1);
+	if (i + 1 == doc->nregion || doc->region[i].new)
+		return;
+	log = &doc->region[i + 1].log;
+	for (n = 0; n < log->nevent; n++)
+		if (EVENT_INDEX == log->event[n].type) {
+			track_set_length(track, log->event[n].a - track_get_start(track));
+			return;
+		}
+}
+
+// split the text at TRACK lines, parse and build the regions; -1 on any error
+static int document_regions(struct Document *doc)
+{
+	const char *end = doc->text + doc->len,
+	           *p = is_track_line(doc->text, end) ? doc->text : track_line(doc->text, end);
+	struct Region *region;
+	int i, size;
+
+	for (i = 0; p; i++, p = track_line(p, end)) {
+		if (i == doc->region_size) {
+			size = doc->region_size ? 2 * doc->region_size : 128;
+			if (!(region = mem_realloc(doc->allocator, doc->region, size * sizeof(*region))))
+				return -1;
+			doc->region = region;
+			doc->region_size = size;
+		}
+		region = &doc->region[i];
+		region->start = i ? p - doc->text : 0;
+		event_log_init(&region->log, doc->parser);
+		region->prev = false;
+		region->new = false;
+		region->file = NULL;
+		doc->nregion = i + 1;
+	}
+	if (!doc->nregion)
+		return -1;
+	for (i = 0; i < doc->nregion; i++)
+		if (region_parse(doc, i))
+			return -1;
+	if (!(doc->cd = parser_cd_init(doc->parser)))
+		return -1;
+	for (i = 0; i < doc->nregion; i++)
+		if (region_replay(doc, i, false) < 0)
+			return -1;
+	parser_reset(doc->parser);
+	return 0;
+}
+
+static int document_parse(struct Document *doc)
+{
+	document_clear(doc);
+	if (!document_regions(doc))
+		return 0;
+	document_clear(doc);
+	parser_reset(doc->parser);
+	// in one piece, to report the errors; the next edit tries regions again
+	doc->cd = parser_cue_buffer(doc->parser, doc->text, doc->len);
+	return doc->cd ? 0 : -1;
+}
 
-//fprintf(stderr, "DEBUG %s:%s\n", __FILE__, __FUNCTION__);
-	if (!yyparse()) ret_cd = cd;
+/*
+ * Parse regions first to last again and rebuild their tracks, then the
+ * tracks after them up to one that starts with the same file as before.
+ * -1 if the TRACK lines changed, to parse the whole text.
+ */
+static int document_reparse(struct Document *doc, int first, int last)
+{
+	const char *end = doc->text + doc->len,
+	           *stop = last + 1 < doc->nregion ? doc->text + doc->region[last + 1].start : NULL,
+	           *p = doc->text + doc->region[first].start;
+	int i, status = 0;
+
+	if (!is_track_line(p, end) && (first || !(p = track_line(p, end))))
+		return -1;
+	for (i = first + 1; i <= last; i++) {
+		if (!(p = track_line(p, end)) || (stop && p >= stop))
+			return -1;
+		doc->region[i].start = p - doc->text;
+	}
+	if (track_line(p, end) != stop)
+		return -1;
+
+	for (i = first; i <= last; i++)
+		if (region_parse(doc, i))
+			return -1;
+	for (i = first; i < doc->nregion; i++)
+		if ((status = region_replay(doc, i, true)) < 0 || (i >= last && !status))
+			break;
+	if (status < 0)
+		return -1;
+	region_length(doc, i < doc->nregion ? i : i - 1);
+	if (first)
+		region_length(doc, first - 1);
+	parser_reset(doc->parser);
+	return 0;
+}
 
-	yy_delete_buffer(buffer);
-	reset_static_vars();
+// the region with the byte at pos
+static int region_at(const struct Document *doc, size_t pos)
+{
+	int lo = 0, hi = doc->nregion - 1, mid;
 
-	return ret_cd;
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (doc->region[mid].start <= pos)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
 }
 
-struct Cd *cue_parse_string(const char* string)
+struct Document *parser_cue_document(struct Parser *parser, const char *buf, size_t len)
 {
-	YY_BUFFER_STATE buffer = NULL;
-	buffer = yy_scan_string(string);
-	struct Cd *ret_cd = NULL;
+	struct Document *doc = mem_calloc(parser->allocator, sizeof(*doc));
+
+	if (!doc)
+		return NULL;
+	doc->allocator = parser->allocator;
+	if (!(doc->parser = parser_init_allocator(parser->allocator))
+	    || !(doc->text = mem_malloc(doc->allocator, len + 1))) {
+		document_free(doc);
+		return NULL;
+	}
+	// tracks are cleared and set again, which a pool would never free
+	doc->parser->flags = (parser->flags | PARSE_FAST_LEX)
+	                     & ~(PARSE_LEX_CHECK | PARSE_ARENA | PARSE_PARALLEL);
+	// the text of UTF-16 input is UTF-8, edits are in UTF-8 too
+	if (parser_is_set_flag(parser, PARSE_ENCODING) && ENCODING_ASCII != encoding_bom(buf, len)) {
+		mem_free(doc->allocator, doc->text);
+		if (!(doc->text = utf16_to_utf8(doc->allocator, buf, len, &len))) {
+			document_free(doc);
+			return NULL;
+		}
+	} else {
+		memcpy(doc->text, buf, len);
+		doc->text[len] = '\0';
+	}
+	doc->len = len;
+	doc->size = len + 1;
+	doc->encoding = parser_guess_encoding(doc->parser, doc->text, len);
+	document_parse(doc);
+	return doc;
+}
 
-//fprintf(stderr, "DEBUG %s:%s\n", __FILE__, __FUNCTION__);
-	if (!yyparse()) ret_cd = cd;
+void document_free(struct Document *doc)
+{
+	if (!doc)
+		return;
+	if (doc->parser)
+		document_clear(doc);
+	mem_free(doc->allocator, doc->region);
+	mem_free(doc->allocator, doc->text);
+	parser_free(doc->parser);
+	mem_free(doc->allocator, doc);
+}
 
-	yy_delete_buffer(buffer);
-	reset_static_vars();
+int document_edit(struct Document *doc, size_t pos, size_t len, const char *text, size_t text_len)
+{
+	size_t size;
+	int first, last, i;
+	char *p;
+
+	if (pos > doc->len || len > doc->len - pos)
+		return -1;
+	size = doc->len - len + text_len + 1;
+	if (size > doc->size) {
+		if (size < 2 * doc->size)
+			size = 2 * doc->size;
+		if (!(p = mem_realloc(doc->allocator, doc->text, size)))
+			return -1;
+		doc->text = p;
+		doc->size = size;
+	}
+	// from the line break before the edit to the byte after it
+	first = region_at(doc, pos ? pos - 1 : 0);
+	last = region_at(doc, pos + len);
+	memmove(doc->text + pos + text_len, doc->text + pos + len, doc->len - pos - len + 1);
+	memcpy(doc->text + pos, text, text_len);
+	doc->len = doc->len - len + text_len;
+	for (i = last + 1; i < doc->nregion; i++)
+		doc->region[i].start = doc->region[i].start - len + text_len;
+	// the first bytes above 0x7F decide, as in a parse of all the text
+	if (ENCODING_ASCII == doc->encoding && !is_ascii(text, text_len))
+		doc->encoding = parser_guess_encoding(doc->parser, doc->text, doc->len);
+
+	if (!doc->nregion || document_reparse(doc, first, last))
+		return document_parse(doc);
+	return 0;
+}
+
+struct Cd *document_get_cd(const struct Document *doc)
+{
+	return doc->cd;
+}
+
+const char *document_get_text(const struct Document *doc, size_t *len)
+{
+	*len = doc->len;
+	return doc->text;
+}
+
+struct Cd *cue_parse_file(FILE *fp)
+{
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_cue_file(parser, fp);
+		parser_free(parser);
+	}
+
+	return cd;
+}
+
+struct Cd *cue_parse_string(const char *string)
+{
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_cue_string(parser, string);
+		parser_free(parser);
+	}
+
+	return cd;
+}
+
+struct Cd *cue_parse_buffer(const char *buf, size_t len)
+{
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_cue_buffer(parser, buf, len);
+		parser_free(parser);
+	}
 
-	return ret_cd;
+	return cd;
 }
@@ -37,7 +37,8 @@ void cue_print_index (long i, FILE *fp)
 void cue_print_track (FILE *fp, struct Track *track, int trackno)
 {
 	struct Cdtext *cdtext = track_get_cdtext(track);
-	int i;	/* index */
+	int	i,	/* index */
+		n;
 	const char *fname = track_get_filename(track);
 
 	/*
@@ -110,7 +111,7 @@ void cue_print_track (FILE *fp, struct Track *track, int trackno)
 	else
 		i = 0;
 
-	for (; i < track_get_nindex(track); i++) {
+	for (n = track_get_nindex(track); i < n; i++) {
 		fprintf(fp, "INDEX %02d ", i);
 		cue_print_index( \
 		track_get_index(track, i) \
@@ -129,7 +130,8 @@ void cue_print(FILE *fp, struct Cd *cd)
 {
 	struct Cdtext *cdtext = cd_get_cdtext(cd);
 	struct Track *track = NULL;
-	int i;	/* track */
+	int	i,	/* track */
+		n = cd_get_ntrack(cd);
 
 	/* print global information */
 	if (cd_get_catalog(cd))
@@ -138,7 +140,7 @@ void cue_print(FILE *fp, struct Cd *cd)
 	cue_print_cdtext(cdtext, fp, 0);
 
 	/* print track information */
-	for (i = 1; i <= cd_get_ntrack(cd); i++) {
+	for (i = 1; i <= n; i++) {
 		track = cd_get_track(cd, i);
 		fprintf(fp, "\n");
 		cue_print_track(fp, track, i);
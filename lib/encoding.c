@@ -0,0 +1,217 @@
+/*
+ * encoding.c -- input encodings (PARSE_ENCODING)
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+/*
+ * Input in ASCII, the common case, is found a vector at a time and never
+ * converted.  Other input is checked to be UTF-8 or else guessed to be one
+ * of the code pages sheets are written in by Windows rippers; CD-TEXT and
+ * other strings are converted with iconv() as they are parsed.
+ */
+
+#include <errno.h>
+#include <iconv.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "encoding.h"
+#include "mem.h"
+
+bool is_ascii(const char *s, size_t len)
+{
+	return kernels.skip_ascii(s, s + len) == s + len;
+}
+
+/*
+ * length of the UTF-8 character at p, 0 if it is none: no stray or missing
+ * continuation bytes, overlong forms, surrogates or code points above U+10FFFF
+ */
+static int utf8_char(const unsigned char *p, const unsigned char *end)
+{
+	int i, n = *p < 0x80 ? 1 : *p < 0xC2 ? 0 : *p < 0xE0 ? 2 : *p < 0xF0 ? 3 : *p < 0xF5 ? 4 : 0;
+
+	if (!n || end - p < n)
+		return 0;
+	for (i = 1; i < n; i++)
+		if (0x80 != (p[i] & 0xC0))
+			return 0;
+	if ((0xE0 == *p && p[1] < 0xA0) || (0xED == *p && p[1] >= 0xA0)
+	    || (0xF0 == *p && p[1] < 0x90) || (0xF4 == *p && p[1] >= 0x90))
+		return 0;
+	return n;
+}
+
+bool utf8_valid(const char *s, size_t len)
+{
+	const char *end = s + len;
+	int n;
+
+	while ((s = kernels.skip_ascii(s, end)) < end) {
+		if (!(n = utf8_char((const unsigned char *)s, (const unsigned char *)end)))
+			return false;
+		s += n;
+	}
+	return true;
+}
+
+/*
+ * every byte above 0x7F is in a Shift-JIS character, most characters of two
+ * bytes are kana or common kanji (lead byte below 0xA0), and some follow
+ * each other; Cyrillic and Western letters are lead bytes from 0xC0 on, and
+ * alone among ASCII in Western words
+ */
+static bool is_shift_jis(const char *s, const char *end)
+{
+	const unsigned char *p;
+	const char *last = NULL;
+	size_t common = 0, rare = 0, next = 0;
+
+	for (; (s = kernels.skip_ascii(s, end)) < end; s++) {
+		p = (const unsigned char *)s;
+		next += s == last;
+		if (0xA1 <= *p && *p <= 0xDF) {	// half-width katakana
+			last = s + 1;
+			continue;
+		}
+		if (!((0x81 <= *p && *p <= 0x9F) || (0xE0 <= *p && *p <= 0xFC))
+		    || end - s < 2 || p[1] < 0x40 || 0x7F == p[1] || p[1] > 0xFC)
+			return false;
+		if (*p <= 0x9F)
+			common++;
+		else
+			rare++;
+		last = ++s + 1;
+	}
+	return common > rare && next;
+}
+
+/*
+ * Cyrillic words are all letters above 0x7F, in Western words they are
+ * single accented letters among ASCII ones
+ */
+static enum Encoding guess_single_byte(const char *s, const char *end)
+{
+	size_t high = 0, next = 0;
+
+	for (; (s = kernels.skip_ascii(s, end)) < end; s++) {
+		high++;
+		next += end - s > 1 && (s[1] & 0x80);
+	}
+	return 2 * next > high ? ENCODING_CP1251 : ENCODING_CP1252;
+}
+
+enum Encoding encoding_guess(const char *s, size_t len)
+{
+	if (utf8_valid(s, len))
+		return ENCODING_UTF8;
+	if (is_shift_jis(s, s + len))
+		return ENCODING_SHIFT_JIS;
+	return guess_single_byte(s, s + len);
+}
+
+enum Encoding encoding_bom(const char *s, size_t len)
+{
+	if (len >= 2 && !memcmp(s, "\xFF\xFE", 2))
+		return ENCODING_UTF16LE;
+	if (len >= 2 && !memcmp(s, "\xFE\xFF", 2))
+		return ENCODING_UTF16BE;
+	return ENCODING_ASCII;
+}
+
+static char *put_utf8(char *q, uint32_t c)
+{
+	if (c < 0x80)
+		*q++ = c;
+	else if (c < 0x800) {
+		*q++ = 0xC0 | c >> 6;
+		*q++ = 0x80 | (c & 0x3F);
+	} else if (c < 0x10000) {
+		*q++ = 0xE0 | c >> 12;
+		*q++ = 0x80 | (c >> 6 & 0x3F);
+		*q++ = 0x80 | (c & 0x3F);
+	} else {
+		*q++ = 0xF0 | c >> 18;
+		*q++ = 0x80 | (c >> 12 & 0x3F);
+		*q++ = 0x80 | (c >> 6 & 0x3F);
+		*q++ = 0x80 | (c & 0x3F);
+	}
+	return q;
+}
+
+// unpaired surrogates become U+FFFD, an odd last byte is dropped
+char *utf16_to_utf8(const struct Allocator *allocator, const char *s, size_t len, size_t *utf8_len)
+{
+	const unsigned char *p = (const unsigned char *)s + 2, *end = (const unsigned char *)s + len;
+	int hi = ENCODING_UTF16BE == encoding_bom(s, len) ? 0 : 1;
+	uint32_t c, c2;
+	char *out, *q;
+
+	// a unit of 2 bytes is at most 3 bytes of UTF-8, a pair of 4 is 4
+	if (!(out = mem_malloc(allocator, len / 2 * 3 + 1)))
+		return NULL;
+	for (q = out; end - p >= 2; p += 2) {
+		c = p[hi] << 8 | p[1 - hi];
+		if (0xD800 <= c && c < 0xE000) {
+			c2 = end - p >= 4 ? p[2 + hi] << 8 | p[3 - hi] : 0;
+			if (c < 0xDC00 && 0xDC00 <= c2 && c2 < 0xE000) {
+				c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+				p += 2;
+			} else
+				c = 0xFFFD;
+		}
+		q = put_utf8(q, c);
+	}
+	*q = '\0';
+	*utf8_len = q - out;
+	return out;
+}
+
+void *transcoder_open(enum Encoding from)
+{
+	iconv_t cd = (iconv_t)-1;
+
+	switch (from) {
+	case ENCODING_SHIFT_JIS:
+		// with the NEC and IBM extensions of Windows, else plain
+		if ((iconv_t)-1 == (cd = iconv_open("UTF-8", "CP932")))
+			cd = iconv_open("UTF-8", "SHIFT_JIS");
+		break;
+	case ENCODING_CP1251:
+		cd = iconv_open("UTF-8", "CP1251");
+		break;
+	case ENCODING_CP1252:
+		cd = iconv_open("UTF-8", "CP1252");
+		break;
+	default:
+		break;
+	}
+	return (iconv_t)-1 == cd ? NULL : cd;
+}
+
+void transcoder_close(void *transcoder)
+{
+	if (transcoder)
+		iconv_close(transcoder);
+}
+
+// bytes with no character become U+FFFD
+size_t transcode(void *transcoder, const char *s, size_t len, char *out, size_t size)
+{
+	char *in = (char *)s, *q = out;
+	size_t left = size - 1;
+
+	iconv(transcoder, NULL, NULL, NULL, NULL);
+	while (len && (size_t)-1 == iconv(transcoder, &in, &len, &q, &left)
+	       && E2BIG != errno && left >= 3) {
+		memcpy(q, "\xEF\xBF\xBD", 3);
+		q += 3;
+		left -= 3;
+		in++;
+		len--;
+	}
+	*q = '\0';
+	return q - out;
+}
@@ -0,0 +1,31 @@
+/*
+ * encoding.h -- input encodings (PARSE_ENCODING)
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libcue.h"
+
+bool is_ascii(const char *s, size_t len);
+bool utf8_valid(const char *s, size_t len);
+// ENCODING_UTF8 if the len bytes at s are valid UTF-8, else the code page they look like
+enum Encoding encoding_guess(const char *s, size_t len);
+
+// ENCODING_UTF16LE or ENCODING_UTF16BE by the byte order mark at s, else ENCODING_ASCII
+enum Encoding encoding_bom(const char *s, size_t len);
+// the UTF-16 at s with its byte order mark in UTF-8, NUL terminated, NULL if out of memory
+char *utf16_to_utf8(const struct Allocator *allocator, const char *s, size_t len, size_t *utf8_len);
+
+// converter from a code page to UTF-8, NULL if the system has none
+void *transcoder_open(enum Encoding from);
+void transcoder_close(void *transcoder);
+// s in UTF-8 at out, cut at a character to fit size with the NUL, return its length
+size_t transcode(void *transcoder, const char *s, size_t len, char *out, size_t size);
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * hash.c -- 128-bit MurmurHash3 (x64 variant) of a stream of values
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <string.h>
+
+#include "hash.h"
+
+#define C1	0x87c37b91114253d5ull
+#define C2	0x4cf5ad432745937full
+
+static uint64_t rotl(uint64_t x, int r)
+{
+	return x << r | x >> (64 - r);
+}
+
+static uint64_t fmix(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdull;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ull;
+	k ^= k >> 33;
+	return k;
+}
+
+static uint64_t load(const unsigned char *p, size_t n)
+{
+	uint64_t v = 0;
+
+	while (n--)
+		v |= (uint64_t)p[n] << 8 * n;
+	return v;
+}
+
+static void store(unsigned char *p, uint64_t v)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = v >> 8 * i;
+}
+
+static uint64_t mix1(uint64_t k)
+{
+	return rotl(k * C1, 31) * C2;
+}
+
+static uint64_t mix2(uint64_t k)
+{
+	return rotl(k * C2, 33) * C1;
+}
+
+static void block(struct Hash *hash, const unsigned char *p)
+{
+	hash->h1 ^= mix1(load(p, 8));
+	hash->h1 = (rotl(hash->h1, 27) + hash->h2) * 5 + 0x52dce729;
+	hash->h2 ^= mix2(load(p + 8, 8));
+	hash->h2 = (rotl(hash->h2, 31) + hash->h1) * 5 + 0x38495ab5;
+}
+
+void hash_init(struct Hash *hash)
+{
+	memset(hash, 0, sizeof(*hash));
+}
+
+void hash_bytes(struct Hash *hash, const void *p, size_t len)
+{
+	const unsigned char *s = p;
+	size_t n;
+
+	hash->len += len;
+	if (hash->n) {
+		n = 16 - hash->n < len ? 16 - hash->n : len;
+		memcpy(hash->block + hash->n, s, n);
+		s += n;
+		len -= n;
+		if ((hash->n += n) < 16)
+			return;
+		block(hash, hash->block);
+		hash->n = 0;
+	}
+	for (; len >= 16; s += 16, len -= 16)
+		block(hash, s);
+	memcpy(hash->block, s, len);
+	hash->n = len;
+}
+
+void hash_long(struct Hash *hash, long v)
+{
+	unsigned char buf[8];
+
+	store(buf, v);
+	hash_bytes(hash, buf, sizeof(buf));
+}
+
+void hash_string(struct Hash *hash, const char *s, size_t len)
+{
+	hash_long(hash, s ? (long)len : -1);
+	if (s)
+		hash_bytes(hash, s, len);
+}
+
+void hash_final(struct Hash *hash, unsigned char out[16])
+{
+	uint64_t h1 = hash->h1, h2 = hash->h2;
+
+	if (hash->n > 8)
+		h2 ^= mix2(load(hash->block + 8, hash->n - 8));
+	if (hash->n)
+		h1 ^= mix1(load(hash->block, hash->n < 8 ? hash->n : 8));
+	h1 ^= hash->len;
+	h2 ^= hash->len;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix(h1);
+	h2 = fmix(h2);
+	h1 += h2;
+	h2 += h1;
+	store(out, h1);
+	store(out + 8, h2);
+}
@@ -0,0 +1,31 @@
+/*
+ * hash.h -- 128-bit MurmurHash3 (x64 variant) of a stream of values
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Hash {
+	uint64_t	h1,
+			h2;
+	unsigned char	block[16];	// bytes not hashed yet
+	size_t		n,		// in block
+			len;		// of the stream
+};
+
+/*
+ * The same stream gives the same hash on every platform: numbers are
+ * hashed as 8 bytes little endian, strings after their length.
+ */
+void hash_init(struct Hash *hash);
+void hash_bytes(struct Hash *hash, const void *p, size_t len);
+void hash_long(struct Hash *hash, long v);
+void hash_string(struct Hash *hash, const char *s, size_t len);	// NULL s is not ""
+void hash_final(struct Hash *hash, unsigned char out[16]);		// h1 and h2 little endian
+
+#endif
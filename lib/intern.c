@@ -0,0 +1,152 @@
+/*
+ * intern.c -- reference counted string table shared by one disc
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "intern.h"
+
+#define NBUCKET	16	// initial size, doubled when there are more strings
+
+struct String {
+	struct String	*next;		// next string in the same bucket
+	uint32_t	hash;
+	unsigned	refs;
+	size_t		len;		// of s, which may hold NUL bytes of a span
+	char		s[];
+};
+
+struct Intern {
+	struct Arena	*arena;		// owner of table and strings
+	struct String	**bucket;
+	size_t		nbucket,	// power of 2
+			count;
+};
+
+// FNV-1a
+static uint32_t hash(const char *s, size_t len)
+{
+	uint32_t h = 2166136261u;
+
+	while (len--)
+		h = (h ^ (unsigned char)*s++) * 16777619u;
+	return h;
+}
+
+struct Intern *intern_init(struct Arena *arena)
+{
+	struct Intern *strings = arena_alloc(arena, sizeof(*strings));
+
+	if (!strings)
+		return NULL;
+	strings->arena = arena;
+	strings->nbucket = NBUCKET;
+	if (!(strings->bucket = arena_alloc(arena, NBUCKET * sizeof(*strings->bucket)))) {
+		arena_release(arena, strings);
+		return NULL;
+	}
+	return strings;
+}
+
+void intern_free(struct Intern *strings)
+{
+	struct String *str, *next;
+	size_t i;
+
+	if (!strings || arena_is_pool(strings->arena))
+		return;
+	for (i = 0; i < strings->nbucket; i++)
+		for (str = strings->bucket[i]; str; str = next) {
+			next = str->next;
+			arena_release(strings->arena, str);
+		}
+	arena_release(strings->arena, strings->bucket);
+	arena_release(strings->arena, strings);
+}
+
+struct Arena *intern_arena(const struct Intern *strings)
+{
+	return strings ? strings->arena : NULL;
+}
+
+// on failure keep the old table, it only gets slower
+static void grow(struct Intern *strings)
+{
+	size_t i, n = strings->nbucket * 2;
+	struct String **bucket = arena_alloc(strings->arena, n * sizeof(*bucket)),
+		      *str, *next;
+
+	if (!bucket)
+		return;
+	for (i = 0; i < strings->nbucket; i++)
+		for (str = strings->bucket[i]; str; str = next) {
+			next = str->next;
+			str->next = bucket[str->hash & (n - 1)];
+			bucket[str->hash & (n - 1)] = str;
+		}
+	arena_release(strings->arena, strings->bucket);
+	strings->bucket = bucket;
+	strings->nbucket = n;
+}
+
+char *intern(struct Intern *strings, const char *s)
+{
+	return intern_len(strings, s, strlen(s));
+}
+
+char *intern_len(struct Intern *strings, const char *s, size_t len)
+{
+	uint32_t h;
+	struct String *str, **head;
+	char *p;
+
+	if (!strings) {
+		if ((p = arena_alloc(NULL, len + 1))) {
+			memcpy(p, s, len);
+			p[len] = '\0';
+		}
+		return p;
+	}
+	h = hash(s, len);
+	head = &strings->bucket[h & (strings->nbucket - 1)];
+	for (str = *head; str; str = str->next)
+		if (str->hash == h && str->len == len && !memcmp(str->s, s, len)) {
+			str->refs++;
+			return str->s;
+		}
+
+	if (!(str = arena_alloc(strings->arena, offsetof(struct String, s) + len + 1)))
+		return NULL;
+	memcpy(str->s, s, len);
+	str->s[len] = '\0';
+	str->hash = h;
+	str->len = len;
+	str->refs = 1;
+	str->next = *head;
+	*head = str;
+	if (++strings->count > strings->nbucket)
+		grow(strings);
+	return str->s;
+}
+
+void intern_release(struct Intern *strings, char *s)
+{
+	struct String *str, **p;
+
+	if (!strings || !s) {
+		arena_release(NULL, s);
+		return;
+	}
+	str = (struct String *)(s - offsetof(struct String, s));
+	if (--str->refs)
+		return;
+	for (p = &strings->bucket[str->hash & (strings->nbucket - 1)]; *p != str; p = &(*p)->next)
+		;
+	*p = str->next;
+	strings->count--;
+	arena_release(strings->arena, str);
+}
@@ -0,0 +1,26 @@
+/*
+ * intern.h -- reference counted string table shared by one disc
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "arena.h"
+
+struct Intern *intern_init(struct Arena *arena);	// table and strings in arena
+void intern_free(struct Intern *strings);		// release the table and all its strings
+struct Arena *intern_arena(const struct Intern *strings);	// arena of the table
+
+/*
+ * Equal strings are stored once: intern() returns the shared copy with one
+ * more reference, intern_release() drops one and frees the copy with the
+ * last.  Interned strings must not be modified.  With a NULL table these
+ * are arena_strdup() and arena_release() without an arena.
+ */
+char *intern(struct Intern *strings, const char *s);
+char *intern_len(struct Intern *strings, const char *s, size_t len);	// s need not be NUL terminated
+void intern_release(struct Intern *strings, char *s);
+
+#endif
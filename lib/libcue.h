@@ -14,6 +14,66 @@
 
 enum Format {CUE, TOC, UNKNOWN};
 
+/*
+ * disc modes
+ * DATA FORM OF MAIN DATA (5.29.2.8)
+ */
+enum DiscMode {
+	MODE_CD_DA,		// CD-DA
+	MODE_CD_ROM,		// CD-ROM mode 1
+	MODE_CD_ROM_XA		// CD-ROM XA and CD-I
+};
+
+/*
+ * track modes
+ * 5.29.2.8 DATA FORM OF MAIN DATA
+ * Table 350 - Data Block Type Codes
+ */
+enum TrackMode {
+	MODE_AUDIO,		// 2352 byte block length
+	MODE_MODE1,		// 2048 byte block length
+	MODE_MODE1_RAW,		// 2352 byte block length
+	MODE_MODE2,		// 2336 byte block length
+	MODE_MODE2_FORM1,	// 2048 byte block length
+	MODE_MODE2_FORM2,	// 2324 byte block length
+	MODE_MODE2_FORM_MIX,	// 2332 byte block length
+	MODE_MODE2_RAW		// 2352 byte block length
+};
+
+/*
+ * sub-channel mode
+ * 5.29.2.13 Data Form of Sub-channel
+ * NOTE: not sure if this applies to cue files
+ */
+enum TrackSubMode {
+	SUB_MODE_RW,		/* RAW Data */
+	SUB_MODE_RW_RAW		/* PACK DATA (written R-W */
+};
+
+/*
+ * track flags
+ * Q Sub-channel Control Field (4.2.3.3, 5.29.2.2)
+ */
+enum TrackFlag {
+	FLAG_NONE		= 0x00,	/* no flags set */
+	FLAG_PRE_EMPHASIS	= 0x01,	/* audio recorded with pre-emphasis */
+	FLAG_COPY_PERMITTED	= 0x02,	/* digital copy permitted */
+	FLAG_DATA		= 0x04,	/* data track */
+	FLAG_FOUR_CHANNEL	= 0x08,	/* 4 audio channels */
+	FLAG_SCMS		= 0x10,	/* SCMS (not Q Sub-ch.) (5.29.2.7) */
+	FLAG_ANY		= 0xff	/* any flags set */
+};
+
+// status of a file parsed by cf_parse_many()
+enum CfError {
+	CF_OK,
+	CF_UNKNOWN_FORMAT,	// no format given, and neither suffix nor content tell it
+	CF_OPEN_ERROR,		// error opening or reading file
+	CF_PARSE_ERROR,		// unable to parse file
+	CF_TOO_LARGE,		// larger than parser_set_max_size()
+	CF_NOT_A_SHEET		// binary data, or UTF-16 without PARSE_ENCODING
+};
+
 // struct Cdtext pack type indicators
 enum Pti {
 	PTI_TITLE,	// title of album or track titles
@@ -45,27 +105,285 @@ enum Rem {
 	REM_SIZE	// terminating REM (for stepping through REMs)
 };
 
-struct Cdtext {
-	char	*pti[PTI_SIZE],
-		*rem[REM_SIZE];
+// parser context options
+enum ParseFlag {
+	PARSE_FAST_LEX	= 0x01,	// scan CUE memory input with the hand-written scanner
+	PARSE_LEX_CHECK	= 0x02,	// scan CUE memory input with both scanners, fail if they differ
+	PARSE_ARENA	= 0x04,	// allocate each struct Cd and all its strings from one arena
+	PARSE_EXTENDED	= 0x08,	// allow up to 100000 tracks, e.g. for chapter lists, instead of 99
+	/*
+	 * keep CD-TEXT and REM values of CUE memory input read by the hand-written
+	 * scanner as spans of the input, copied on the first cdtext_get() or
+	 * rem_get(); the input must outlive the disc
+	 */
+	PARSE_LAZY_TEXT	= 0x10,
+	/*
+	 * split large CUE memory input read by the hand-written scanner at TRACK
+	 * lines and parse the parts on parser_set_threads() threads; the disc is
+	 * the same as from one parse, a sheet with errors is parsed again in one
+	 * piece to report them
+	 */
+	PARSE_PARALLEL	= 0x20,
+	/*
+	 * read UTF-16 input with a byte order mark as UTF-8, and give strings of
+	 * input that is no UTF-8 in UTF-8, from the code page its bytes above
+	 * 0x7F look like; see parser_get_encoding()
+	 */
+	PARSE_ENCODING	= 0x40
+};
+
+// encoding of the input (PARSE_ENCODING)
+enum Encoding {
+	ENCODING_ASCII,		// no string with bytes above 0x7F
+	ENCODING_UTF8,
+	ENCODING_UTF16LE,	// by the byte order mark
+	ENCODING_UTF16BE,
+	ENCODING_SHIFT_JIS,	// guessed: Japanese (CP932)
+	ENCODING_CP1251,	// Cyrillic
+	ENCODING_CP1252		// Western European
+};
+
+struct Cdtext;	// opaque, see cdtext_get() and rem_get()
+
+/*
+ * parse events (parser_*_events()), to read a sheet without building a struct Cd
+ *
+ * Any callback may be NULL.  Strings are only valid during the call.  CD-TEXT
+ * and REM events before the first track event belong to the disc, later ones
+ * to the last track, CUE file events to the tracks that follow.  A callback
+ * returns 0 to go on, anything else stops the parse and is returned by
+ * parser_*_events().
+ */
+struct ParseEvents {
+	int	(*catalog)(void *data, const char *catalog);
+	int	(*cdtextfile)(void *data, const char *cdtextfile);
+	int	(*disc_mode)(void *data, enum DiscMode mode);
+	int	(*track)(void *data, int number, enum TrackMode mode, enum TrackSubMode sub_mode);
+	int	(*flag)(void *data, enum TrackFlag flag, int set);
+	int	(*isrc)(void *data, const char *isrc);
+	int	(*file)(void *data, const char *name, long start, long length);	// -1 if not given
+	int	(*pregap)(void *data, long length);
+	int	(*index)(void *data, int i, long index);
+	int	(*postgap)(void *data, long length);
+	int	(*cdtext)(void *data, enum Pti pti, const char *value);
+	int	(*rem)(void *data, enum Rem rem, const char *value);
+};
+
+/*
+ * allocator callbacks (mem.c), for all memory of libcue: parsers, scanner
+ * buffers and discs
+ *
+ * The struct must stay valid while anything allocated with it lives; a
+ * disc is freed with the allocator of the parser that built it.
+ */
+struct Allocator {
+	void	*(*malloc)(void *data, size_t size);
+	void	*(*realloc)(void *data, void *ptr, size_t size);
+	void	(*free)(void *data, void *ptr);
+	void	*data;
+};
+
+void cue_set_allocator(const struct Allocator *allocator);	// process-wide, NULL for malloc(); set before use
+
+/*
+ * statistics (stats.c), counted per thread so threads never contend
+ *
+ * Enabling costs a clock read per token.  cf_parse_many() adds the counts of
+ * its workers to the calling thread.
+ */
+struct Stats {				// all unsigned long
+	unsigned long	bytes,		// input scanned
+			tokens,
+			statements,	// parse events, one per statement
+			errors,		// syntax errors reported by yyerror()
+			allocs,		// calls to the allocator, realloc() included
+			alloc_bytes,
+			lex_usec,	// time in the scanners
+			parse_usec,	// time in the parsers, without the scanners
+			print_usec;	// time in cf_print()
+};
+
+void cue_stats_enable(int enable);	// for all threads, set before use
+void cue_stats_get(struct Stats *stats);	// snapshot of the calling thread
+void cue_stats_reset(void);		// of the calling thread
+void cue_stats_print(FILE *fp, const struct Stats *stats);
+
+// instruction sets of the vector kernels (cpu.c)
+enum CpuFeature {
+	CPU_SSE2	= 0x01,
+	CPU_SSE42	= 0x02,
+	CPU_PCLMUL	= 0x04,
+	CPU_AVX2	= 0x08,
+	CPU_AVX512	= 0x10,	// AVX-512 F and BW
+	CPU_NEON	= 0x20
 };
 
+/*
+ * Scanning kernels are bound at load to the best version the CPU has.
+ * LIBCUE_CPU in the environment, one of scalar, sse2, sse4.2, avx2, avx512
+ * or neon, allows no level above that one, for testing.
+ */
+int cue_cpu_features(void);	// enum CpuFeature in use
+int cue_cpu_selftest(FILE *fp);	// every version the CPU has against the scalar one, returns how many differ, named on fp if not NULL
+
+// parser context (parser.c), reusable for any number of parses, one per thread
+struct Parser *parser_init(void);
+struct Parser *parser_init_allocator(const struct Allocator *allocator);	// NULL for the process-wide one
+void parser_free(struct Parser *parser);
+void parser_reset(struct Parser *parser);
+void parser_set_flag(struct Parser *parser, enum ParseFlag flag);
+void parser_clear_flag(struct Parser *parser, enum ParseFlag flag);
+int parser_is_set_flag(const struct Parser *parser, enum ParseFlag flag);
+/*
+ * stop parsing into a struct Cd once track is complete, 0 after the global
+ * statements, -1 to parse everything (default); the rest is not scanned
+ */
+void parser_set_last_track(struct Parser *parser, int track);
+void parser_set_threads(struct Parser *parser, int nthread);	// for PARSE_PARALLEL, number of online CPUs if <= 0 (default)
+void parser_set_max_size(struct Parser *parser, size_t size);	// of files for parser_cf_parse(), 0 for any (default 64 MiB)
+enum Encoding parser_get_encoding(const struct Parser *parser);	// of the last input, with PARSE_ENCODING
+
 // cue_parse.y
 struct Cd *cue_parse_file(FILE *);
 struct Cd *cue_parse_string(const char *);
+struct Cd *parser_cue_file(struct Parser *parser, FILE *fp);
+struct Cd *parser_cue_string(struct Parser *parser, const char *string);
+
+// parse the len bytes at buf, they need no terminating NUL and are never duplicated
+struct Cd *cue_parse_buffer(const char *buf, size_t len);
+struct Cd *parser_cue_buffer(struct Parser *parser, const char *buf, size_t len);
+
+// parse into events, return 0, -1 on a syntax error or the value of the callback that stopped it
+int parser_cue_file_events(struct Parser *parser, FILE *fp, const struct ParseEvents *events, void *data);
+int parser_cue_buffer_events(struct Parser *parser, const char *buf, size_t len, const struct ParseEvents *events, void *data);
+
+/*
+ * CUE sheet kept for editing, e.g. while it is typed: a copy of memory input
+ * and its disc.  document_edit() replaces len bytes at pos and parses again
+ * only the tracks from the line before to the byte after them; the other
+ * tracks keep their nodes, and lengths and files that follow from the edited
+ * tracks are set again.  An edit that adds or removes a TRACK line, or text
+ * with errors, is parsed in one piece, which reports the errors.  The disc
+ * belongs to the document, it is NULL while the text does not parse; edits
+ * return 0, or -1 then or if pos and len are out of range.
+ */
+struct Document;
+struct Document *parser_cue_document(struct Parser *parser, const char *buf, size_t len);	// with the options of parser
+void document_free(struct Document *doc);
+int document_edit(struct Document *doc, size_t pos, size_t len, const char *text, size_t text_len);
+struct Cd *document_get_cd(const struct Document *doc);
+const char *document_get_text(const struct Document *doc, size_t *len);	// NUL terminated
+
+/*
+ * Absolute frames of a disc (timeline.c), across its files and with PREGAP
+ * and POSTGAP zero data, built once to seek in: timeline_find() is a binary
+ * search.  file_length, if not NULL, returns the frames of a data file or -1
+ * if unknown.  A file before another needs it unless the sheet gives its
+ * end, as TOC sheets do; without the length of the last file the end of the
+ * disc is unknown.  NULL if a length is missing or indexes go back.  Tracks
+ * count from 1; a pregap of zero data is index 0.
+ */
+struct Timeline;
+struct Timeline *cd_timeline(const struct Cd *cd, long (*file_length)(void *data, const char *name), void *data);
+void timeline_free(struct Timeline *timeline);
+long timeline_get_length(const struct Timeline *timeline);	// -1 if unknown
+long timeline_get_start(const struct Timeline *timeline, int track);	// of its first index
+long timeline_get_end(const struct Timeline *timeline, int track);	// start of the next track, -1 if unknown
+long timeline_get_index(const struct Timeline *timeline, int track, int i);	// -1 if unset
+int timeline_find(const struct Timeline *timeline, long frame, int *index);	// track and index with frame, 0 if none
+
+/*
+ * bytes of the tracks in their data files (sector.c), by track_get_block_size()
+ * of each track, also where tracks of different modes share a file.  A CUE
+ * track runs from its first index in its file, its pregap in the file
+ * included, to the start of the next one.  Offsets are -1 if unknown, sizes
+ * -1 for a track that runs to the end of its file.  Audio has 588 samples of
+ * 4 bytes (16 bit stereo) per frame; sample offsets are -1 for other modes.
+ * Each cd_get_track_*() walks the tracks before i, cd_get_track_ranges()
+ * fills arrays of cd_get_ntrack() entries in one walk, any may be NULL.
+ */
+long long cd_get_track_offset(const struct Cd *cd, int i);
+long long cd_get_track_size(const struct Cd *cd, int i);
+long long cd_get_track_sample(const struct Cd *cd, int i);
+int cd_get_track_ranges(const struct Cd *cd, long long *offset, long long *size, long long *sample);	// returns the number of tracks
+
+/*
+ * lossless CUE sheet (sheet.c): the statements of memory input with the
+ * spans of their values, to edit values in place; the input must outlive
+ * the sheet
+ *
+ * sheet_print() writes the input with only the edited values replaced, so
+ * comments, unknown REM lines, quoting, spacing and order stay as they are.
+ * Setters change the last statement for a track (0 for the disc) like a
+ * parse would keep it, and return 0 or -1 if there is none or the value
+ * can't be written, e.g. with a newline.
+ */
+struct Sheet;
+struct Sheet *parser_cue_sheet(struct Parser *parser, const char *buf, size_t len);
+void sheet_free(struct Sheet *sheet);
+int sheet_get_nfile(const struct Sheet *sheet);	// FILE statements, i below counts from 0
+const char *sheet_get_file(const struct Sheet *sheet, int i, size_t *len);	// not NUL terminated
+int sheet_set_file(struct Sheet *sheet, int i, const char *name);
+int sheet_set_cdtext(struct Sheet *sheet, int track, enum Pti pti, const char *value);
+int sheet_set_index(struct Sheet *sheet, int track, int i, long index);
+int sheet_print(FILE *fp, const struct Sheet *sheet);
+
+// toc_parse.y
+struct Cd *toc_parse_string(const char *);
+struct Cd *parser_toc_file(struct Parser *parser, FILE *fp);
+struct Cd *parser_toc_string(struct Parser *parser, const char *string);
+struct Cd *toc_parse_buffer(const char *buf, size_t len);
+struct Cd *parser_toc_buffer(struct Parser *parser, const char *buf, size_t len);
+int parser_toc_file_events(struct Parser *parser, FILE *fp, const struct ParseEvents *events, void *data);
+int parser_toc_buffer_events(struct Parser *parser, const char *buf, size_t len, const struct ParseEvents *events, void *data);
 
 // cuefile functions (cd.c)
 struct Cd *cf_parse(char *fname, enum Format *format);
+struct Cd *parser_cf_parse(struct Parser *parser, char *fname, enum Format *format);	// with the options of parser
+int cf_parse_many(char **fnames, enum Format *formats, struct Cd **cds, enum CfError *errors, int n, int nthreads);
 enum Format cf_format_from_suffix(char *name);
+enum Format cf_format_sniff(const char *buf, size_t len);	// by the keywords of the first 4 KiB, UNKNOWN for binary data
 int cf_print(char *fname, enum Format *format, struct Cd *cue);
 
 // Cd functions (cd.c)
 struct Cd *cd_init(void);
-void cd_free(struct Cd *cd);
+void cd_free(struct Cd *cd);	// cd_unref()
 void cd_dump(struct Cd *cd);
 int cd_get_ntrack(const struct Cd *cd);
 struct Track *cd_get_track(const struct Cd *cd, int i);
 
+/*
+ * A disc starts with one reference, cd_unref() of the last frees it.  A
+ * frozen disc is never written: setters return -1 and leave it as it is, and
+ * any number of threads read it without a lock.  cd_ref() freezes the disc,
+ * so a shared disc is always frozen; call it before handing the disc on.
+ */
+struct Cd *cd_ref(struct Cd *cd);	// returns cd frozen with one more reference, NULL if out of memory
+void cd_unref(struct Cd *cd);
+int cd_freeze(struct Cd *cd);		// -1 if out of memory, cd is not frozen then
+int cd_is_frozen(const struct Cd *cd);
+
+/*
+ * A disc to write: cd itself if the caller holds its only reference and it
+ * is not frozen, otherwise a copy that takes over the caller's reference to
+ * cd, frozen now.  The copy borrows the tracks and CD-TEXT of cd until a
+ * setter writes them, which copies only the track or CD-TEXT written.
+ * NULL if out of memory, the caller keeps its reference to cd then.
+ */
+struct Cd *cd_edit(struct Cd *cd);
+
+// what cd_fingerprint() covers besides the tracks, their indexes and ISRC, and the catalog
+enum FingerprintFlag {
+	FINGERPRINT_FILENAMES	= 0x01,	// names of the data files and the CD-TEXT file
+	FINGERPRINT_CDTEXT	= 0x02	// CD-TEXT and REM values
+};
+
+/*
+ * 128 bits equal for discs with equal contents, however the sheets were
+ * written, and the same on every platform; flags are enum FingerprintFlag.
+ */
+void cd_fingerprint(const struct Cd *cd, int flags, unsigned char fingerprint[16]);
+
 // Track functions (cd.c)
 char *track_get_filename(const struct Track *track);
 long track_get_start(const struct Track *track);
@@ -74,11 +392,22 @@ long track_get_zero_pre(const struct Track *track);
 long track_get_zero_post(const struct Track *track);
 char *track_get_isrc(const struct Track *track);
 long track_get_index(const struct Track *track, int i);
+int track_get_block_size(const struct Track *track);	// bytes per frame in the data file, by the track mode (sector.c)
+// setters return 0, -1 if the disc is frozen or out of memory
+int track_set_filename(struct Track *track, const char *filename);	// filename of data file
+int track_set_isrc(struct Track *track, const char *isrc);
+int track_set_index(struct Track *track, int i, long index);
 
 // Cdtext & REM functions (cdtext.c)
 char *cdtext_get(const struct Cdtext *cdtext, enum Pti i);
 struct Cdtext *cd_get_cdtext(const struct Cd *cd);
 struct Cdtext *track_get_cdtext(const struct Track *track);
 char *rem_get(struct Cdtext *cdtext, enum Rem i);
+int cdtext_set(struct Cdtext *cdtext, enum Pti i, const char *value);	// set CD-TEXT field to value for PTI pti
+int rem_set(struct Cdtext *cdtext, enum Rem i, const char *value);
+
+// the len bytes of a value, not NUL terminated and never copied; NULL if unset
+const char *cdtext_get_span(const struct Cdtext *cdtext, enum Pti i, size_t *len);
+const char *rem_get_span(const struct Cdtext *cdtext, enum Rem i, size_t *len);
 
 #endif
@@ -0,0 +1,88 @@
+/*
+ * mem.c -- allocation through struct Allocator callbacks
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem.h"
+#include "stats.h"
+
+static void *libc_malloc(void *data, size_t size)
+{
+	return malloc(size);
+}
+
+static void *libc_realloc(void *data, void *ptr, size_t size)
+{
+	return realloc(ptr, size);
+}
+
+static void libc_free(void *data, void *ptr)
+{
+	free(ptr);
+}
+
+static const struct Allocator libc = {
+	.malloc		= libc_malloc,
+	.realloc	= libc_realloc,
+	.free		= libc_free
+};
+
+// set before any parser or disc exists, not synchronized
+static const struct Allocator *process = &libc;
+
+void cue_set_allocator(const struct Allocator *allocator)
+{
+	process = allocator ? allocator : &libc;
+}
+
+const struct Allocator *mem_allocator(const struct Allocator *allocator)
+{
+	return allocator ? allocator : process;
+}
+
+void *mem_malloc(const struct Allocator *allocator, size_t size)
+{
+	allocator = mem_allocator(allocator);
+	STATS_ADD(allocs, 1);
+	STATS_ADD(alloc_bytes, size);
+	return allocator->malloc(allocator->data, size);
+}
+
+void *mem_calloc(const struct Allocator *allocator, size_t size)
+{
+	void *p = mem_malloc(allocator, size);
+
+	if (p)
+		memset(p, 0, size);
+	return p;
+}
+
+void *mem_realloc(const struct Allocator *allocator, void *ptr, size_t size)
+{
+	allocator = mem_allocator(allocator);
+	STATS_ADD(allocs, 1);
+	STATS_ADD(alloc_bytes, size);
+	return allocator->realloc(allocator->data, ptr, size);
+}
+
+void mem_free(const struct Allocator *allocator, void *ptr)
+{
+	if (!ptr)
+		return;
+	allocator = mem_allocator(allocator);
+	allocator->free(allocator->data, ptr);
+}
+
+char *mem_strdup(const struct Allocator *allocator, const char *s)
+{
+	size_t n = strlen(s) + 1;
+	char *p = mem_malloc(allocator, n);
+
+	if (p)
+		memcpy(p, s, n);
+	return p;
+}
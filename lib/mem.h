@@ -0,0 +1,26 @@
+/*
+ * mem.h -- allocation through struct Allocator callbacks
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef MEM_H
+#define MEM_H
+
+#include <stddef.h>
+
+#include "libcue.h"
+
+/*
+ * A NULL allocator is the process-wide one set with cue_set_allocator().
+ * Objects keep the resolved allocator, so later changes don't affect them.
+ */
+const struct Allocator *mem_allocator(const struct Allocator *allocator);
+
+void *mem_malloc(const struct Allocator *allocator, size_t size);
+void *mem_calloc(const struct Allocator *allocator, size_t size);	// zeroed
+void *mem_realloc(const struct Allocator *allocator, void *ptr, size_t size);
+void mem_free(const struct Allocator *allocator, void *ptr);		// NULL ptr is ok
+char *mem_strdup(const struct Allocator *allocator, const char *s);
+
+#endif
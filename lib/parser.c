@@ -0,0 +1,603 @@
+/*
+ * parser.c -- reentrant parser context
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cdtext.h"
+#include "encoding.h"
+#include "mem.h"
+#include "parser.h"
+
+struct Parser *parser_init_allocator(const struct Allocator *allocator)
+{
+	struct Parser *parser;
+
+	allocator = mem_allocator(allocator);
+	if (!(parser = mem_calloc(allocator, sizeof(*parser))))
+		return NULL;
+	parser->allocator = allocator;	// for the scanners from here on
+	parser->last_track = -1;
+	parser->max_size = PARSER_MAX_SIZE;
+	if (cue_yylex_init_extra(parser, &parser->cue_scanner)
+	    || toc_yylex_init_extra(parser, &parser->toc_scanner)) {
+		fprintf(stderr, "unable to create scanner\n");
+		parser_free(parser);
+		return NULL;
+	}
+	return parser;
+}
+
+struct Parser *parser_init(void)
+{
+	return parser_init_allocator(NULL);
+}
+
+void parser_free(struct Parser *parser)
+{
+	if (!parser)
+		return;
+	if (parser->cue_scanner)
+		cue_yylex_destroy(parser->cue_scanner);
+	if (parser->toc_scanner)
+		toc_yylex_destroy(parser->toc_scanner);
+	mem_free(parser->allocator, parser);
+}
+
+// forget the input and the state of the last parse, keep the scanner buffers
+void parser_reset(struct Parser *parser)
+{
+	parser->fp		= NULL;
+	parser->str		= NULL;
+	parser->len		= 0;
+	parser->pos		= 0;
+	mem_free(parser->allocator, parser->input);
+	parser->input		= NULL;
+	transcoder_close(parser->transcoder);
+	parser->transcoder	= NULL;
+
+	parser->lex_tok		= NULL;
+	parser->lex_cur		= NULL;
+	parser->lex_stop	= NULL;
+	parser->lex_state	= LEX_INITIAL;
+	parser->lex_bol		= true;
+	parser->lex_error	= false;
+
+	parser->events		= NULL;
+	parser->data		= NULL;
+	parser->status		= 0;
+	parser->nerror		= 0;
+	parser->quiet		= false;
+	parser->ntrack		= 0;
+	parser->nindex		= 0;
+	parser->track_file	= false;
+
+	parser->done		= false;
+	parser->reuse_track	= 0;
+	parser->cd		= NULL;
+	parser->track		= NULL;
+	parser->prev_track	= NULL;
+	parser->cdtext		= NULL;
+	parser->prev_filename	= NULL;
+	parser->cur_filename	= NULL;
+	parser->new_filename	= NULL;
+	parser->span		= NULL;
+
+	cue_scan_reset(parser->cue_scanner);
+	toc_scan_reset(parser->toc_scanner);
+}
+
+void parser_input_file(struct Parser *parser, FILE *fp)
+{
+	parser_reset(parser);
+	parser->fp = fp;
+	parser->encoding = ENCODING_ASCII;
+}
+
+void parser_input_buffer(struct Parser *parser, const char *buf, size_t len)
+{
+	enum Encoding encoding = ENCODING_ASCII;
+
+	parser_reset(parser);
+	if (parser_is_set_flag(parser, PARSE_ENCODING) && ENCODING_ASCII != (encoding = encoding_bom(buf, len))
+	    && (parser->input = utf16_to_utf8(parser->allocator, buf, len, &len)))
+		buf = parser->input;
+	parser->str	= buf;
+	parser->len	= len;
+	parser->lex_cur	= buf;
+	parser->encoding = encoding;
+}
+
+struct Cd *parser_cd_init(struct Parser *parser)
+{
+	struct Cd *cd = cd_new(parser->allocator, parser_is_set_flag(parser, PARSE_ARENA));
+
+	if (cd) {
+		parser->cd	= cd;
+		parser->cdtext	= cd_get_cdtext(cd);
+		cd_set_extended(cd, parser_is_set_flag(parser, PARSE_EXTENDED));
+	}
+	return cd;
+}
+
+void parser_set_flag(struct Parser *parser, enum ParseFlag flag)
+{
+	parser->flags |= flag;
+}
+
+void parser_clear_flag(struct Parser *parser, enum ParseFlag flag)
+{
+	parser->flags &= ~flag;
+}
+
+int parser_is_set_flag(const struct Parser *parser, enum ParseFlag flag)
+{
+	return parser->flags & flag;
+}
+
+void parser_set_last_track(struct Parser *parser, int track)
+{
+	parser->last_track = track < 0 ? -1 : track;
+}
+
+void parser_set_threads(struct Parser *parser, int nthread)
+{
+	parser->nthread = nthread;
+}
+
+void parser_set_max_size(struct Parser *parser, size_t size)
+{
+	parser->max_size = size;
+}
+
+enum Encoding parser_get_encoding(const struct Parser *parser)
+{
+	return parser->encoding;
+}
+
+// read the rest of a UTF-16 file after the n bytes at buf, in UTF-8 as memory input
+static bool read_utf16(struct Parser *parser, const char *buf, size_t n)
+{
+	size_t size = 2 * n;
+	char *raw = mem_malloc(parser->allocator, size), *p;
+
+	if (!raw)
+		return false;
+	memcpy(raw, buf, n);
+	while (!feof(parser->fp) && !ferror(parser->fp)) {
+		if (n == size) {
+			if (!(p = mem_realloc(parser->allocator, raw, 2 * size))) {
+				mem_free(parser->allocator, raw);
+				return false;
+			}
+			raw = p;
+			size *= 2;
+		}
+		n += fread(raw + n, 1, size - n, parser->fp);
+	}
+	parser->input = utf16_to_utf8(parser->allocator, raw, n, &parser->len);
+	mem_free(parser->allocator, raw);
+	parser->str = parser->input;
+	parser->pos = 0;
+	return parser->input;
+}
+
+size_t parser_read(struct Parser *parser, char *buf, size_t max)
+{
+	size_t n;
+
+	if (parser->fp && !parser->input) {
+		if (!(n = fread(buf, 1, max, parser->fp)) && ferror(parser->fp))
+			fprintf(stderr, "error reading input\n");
+		if (parser->pos || !parser_is_set_flag(parser, PARSE_ENCODING)
+		    || ENCODING_ASCII == (parser->encoding = encoding_bom(buf, n)) || !read_utf16(parser, buf, n)) {
+			parser->pos += n;
+			STATS_ADD(bytes, n);
+			return n;
+		}
+	}
+
+	n = parser->len - parser->pos;
+	if (n > max)
+		n = max;
+	memcpy(buf, parser->str + parser->pos, n);
+	parser->pos += n;
+	STATS_ADD(bytes, n);
+	return n;
+}
+
+enum Encoding parser_guess_encoding(const struct Parser *parser, const char *buf, size_t len)
+{
+	if (!parser_is_set_flag(parser, PARSE_ENCODING) || is_ascii(buf, len))
+		return ENCODING_ASCII;
+	return encoding_guess(buf, len);
+}
+
+void parser_set_encoding(struct Parser *parser, enum Encoding encoding)
+{
+	transcoder_close(parser->transcoder);
+	parser->encoding = encoding;
+	parser->transcoder = ENCODING_ASCII != encoding ? transcoder_open(encoding) : NULL;
+}
+
+/*
+ * copy a string of a code page to the token buffer in UTF-8 (PARSE_ENCODING),
+ * false if it is copied as it is; the first string with bytes above 0x7F
+ * decides the encoding, from all memory input or else from the string
+ */
+static bool transcode_string(struct Parser *parser, const char *s, size_t len)
+{
+	if (!parser_is_set_flag(parser, PARSE_ENCODING) || is_ascii(s, len))
+		return false;
+	if (ENCODING_ASCII == parser->encoding) {
+		parser->encoding = parser->str ? encoding_guess(parser->str, parser->len) : encoding_guess(s, len);
+		parser->transcoder = transcoder_open(parser->encoding);
+	}
+	if (!parser->transcoder)
+		return false;
+	transcode(parser->transcoder, s, len, parser->buffer, sizeof(parser->buffer));
+	return true;
+}
+
+// token buffer with the string, true if it is not as in the input
+static bool string_copy(struct Parser *parser, const char *s, size_t len)
+{
+	parser->span = NULL;
+	if (transcode_string(parser, s, len))
+		return true;
+	if (len >= sizeof(parser->buffer))
+		len = sizeof(parser->buffer) - 1;
+	memcpy(parser->buffer, s, len);
+	parser->buffer[len] = '\0';
+	return parser->input;
+}
+
+char *parser_string(struct Parser *parser, const char *s, size_t len)
+{
+	string_copy(parser, s, len);
+	return parser->buffer;
+}
+
+char *parser_string_span(struct Parser *parser, const char *s, size_t len)
+{
+	// what the copy holds: truncated, and up to a NUL; converted is no span
+	if (!string_copy(parser, s, len)) {
+		parser->span = s;
+		parser->span_len = strlen(parser->buffer);
+	}
+	return parser->buffer;
+}
+
+// STRING value of a CD-TEXT or REM statement kept as a span (PARSE_LAZY_TEXT)
+static bool lazy_text(struct Parser *parser, const char *value)
+{
+	return parser_is_set_flag(parser, PARSE_LAZY_TEXT)
+	       && value == parser->buffer && parser->span && parser->span_len;
+}
+
+/* struct Cd builder */
+
+int build_catalog(void *data, const char *catalog)
+{
+	struct Parser *parser = data;
+
+	cd_set_catalog(parser->cd, catalog);
+	return 0;
+}
+
+int build_cdtextfile(void *data, const char *cdtextfile)
+{
+	struct Parser *parser = data;
+
+	cd_set_cdtextfile(parser->cd, cdtextfile);
+	return 0;
+}
+
+int build_disc_mode(void *data, enum DiscMode mode)
+{
+	struct Parser *parser = data;
+
+	cd_set_mode(parser->cd, mode);
+	return 0;
+}
+
+int build_flag(void *data, enum TrackFlag flag, int set)
+{
+	struct Parser *parser = data;
+
+	if (set)
+		track_set_flag(parser->track, flag);
+	else
+		track_clear_flag(parser->track, flag);
+	return 0;
+}
+
+int build_isrc(void *data, const char *isrc)
+{
+	struct Parser *parser = data;
+
+	track_set_isrc(parser->track, isrc);
+	return 0;
+}
+
+int build_pregap(void *data, long length)
+{
+	struct Parser *parser = data;
+
+	track_set_zero_pre(parser->track, length);
+	return 0;
+}
+
+int build_postgap(void *data, long length)
+{
+	struct Parser *parser = data;
+
+	track_set_zero_post(parser->track, length);
+	return 0;
+}
+
+int build_cdtext(void *data, enum Pti pti, const char *value)
+{
+	struct Parser *parser = data;
+
+	if (lazy_text(parser, value))
+		cdtext_set_span(parser->cdtext, pti, parser->span, parser->span_len);
+	else
+		cdtext_set(parser->cdtext, pti, value);
+	return 0;
+}
+
+int build_rem(void *data, enum Rem rem, const char *value)
+{
+	struct Parser *parser = data;
+
+	if (lazy_text(parser, value))
+		rem_set_span(parser->cdtext, rem, parser->span, parser->span_len);
+	else
+		rem_set(parser->cdtext, rem, value);
+	return 0;
+}
+
+/* event log */
+
+void event_log_init(struct EventLog *log, struct Parser *parser)
+{
+	memset(log, 0, sizeof(*log));
+	log->parser = parser;
+}
+
+void event_log_free(struct EventLog *log)
+{
+	mem_free(log->parser->allocator, log->event);
+	mem_free(log->parser->allocator, log->strings);
+	event_log_init(log, log->parser);
+}
+
+static struct Event *event_add(struct EventLog *log, enum EventType type)
+{
+	struct Event *event = log->event;
+	size_t size;
+
+	if (log->nevent == log->size) {
+		size = log->size ? 2 * log->size : 16;
+		if (!(event = mem_realloc(log->parser->allocator, event, size * sizeof(*event))))
+			return NULL;
+		log->event = event;
+		log->size = size;
+	}
+	event = &log->event[log->nevent++];
+	event->type = type;
+	return event;
+}
+
+// keep a span of the token buffer, copy other strings
+static int event_string(struct EventLog *log, struct Event *event, const char *s)
+{
+	struct Parser *parser = log->parser;
+	size_t size;
+	char *strings;
+
+	if (s == parser->buffer && parser->span && !log->copy) {
+		event->span = parser->span;
+		event->len = parser->span_len;
+		return 0;
+	}
+	event->span = NULL;
+	event->len = strlen(s);
+	if (log->strings_size - log->nstrings <= event->len) {
+		for (size = log->strings_size ? log->strings_size : 4096; size - log->nstrings <= event->len; )
+			size *= 2;
+		if (!(strings = mem_realloc(parser->allocator, log->strings, size)))
+			return -1;
+		log->strings = strings;
+		log->strings_size = size;
+	}
+	memcpy(log->strings + log->nstrings, s, event->len + 1);
+	event->str = log->nstrings;
+	log->nstrings += event->len + 1;
+	return 0;
+}
+
+static struct Event *record_string(struct EventLog *log, enum EventType type, int i, const char *s)
+{
+	struct Event *event = event_add(log, type);
+
+	if (!event || event_string(log, event, s))
+		return NULL;
+	event->i = i;
+	return event;
+}
+
+static int record(struct EventLog *log, enum EventType type, int i, long a, long b)
+{
+	struct Event *event = event_add(log, type);
+
+	if (!event)
+		return -1;
+	event->i = i;
+	event->a = a;
+	event->b = b;
+	return 0;
+}
+
+static int record_catalog(void *data, const char *catalog)
+{
+	return record_string(data, EVENT_CATALOG, 0, catalog) ? 0 : -1;
+}
+
+static int record_cdtextfile(void *data, const char *cdtextfile)
+{
+	return record_string(data, EVENT_CDTEXTFILE, 0, cdtextfile) ? 0 : -1;
+}
+
+static int record_disc_mode(void *data, enum DiscMode mode)
+{
+	return record(data, EVENT_DISC_MODE, mode, 0, 0);
+}
+
+static int record_track(void *data, int number, enum TrackMode mode, enum TrackSubMode sub_mode)
+{
+	return record(data, EVENT_TRACK, number, mode, sub_mode);
+}
+
+static int record_flag(void *data, enum TrackFlag flag, int set)
+{
+	return record(data, EVENT_FLAG, flag, set, 0);
+}
+
+static int record_isrc(void *data, const char *isrc)
+{
+	return record_string(data, EVENT_ISRC, 0, isrc) ? 0 : -1;
+}
+
+static int record_file(void *data, const char *name, long start, long length)
+{
+	struct Event *event = record_string(data, EVENT_FILE, 0, name);
+
+	if (!event)
+		return -1;
+	event->a = start;
+	event->b = length;
+	return 0;
+}
+
+static int record_pregap(void *data, long length)
+{
+	return record(data, EVENT_PREGAP, 0, length, 0);
+}
+
+static int record_index(void *data, int i, long index)
+{
+	return record(data, EVENT_INDEX, i, index, 0);
+}
+
+static int record_postgap(void *data, long length)
+{
+	return record(data, EVENT_POSTGAP, 0, length, 0);
+}
+
+static int record_cdtext(void *data, enum Pti pti, const char *value)
+{
+	return record_string(data, EVENT_CDTEXT, pti, value) ? 0 : -1;
+}
+
+static int record_rem(void *data, enum Rem rem, const char *value)
+{
+	return record_string(data, EVENT_REM, rem, value) ? 0 : -1;
+}
+
+const struct ParseEvents event_log_record = {
+	.catalog	= record_catalog,
+	.cdtextfile	= record_cdtextfile,
+	.disc_mode	= record_disc_mode,
+	.track		= record_track,
+	.flag		= record_flag,
+	.isrc		= record_isrc,
+	.file		= record_file,
+	.pregap		= record_pregap,
+	.index		= record_index,
+	.postgap	= record_postgap,
+	.cdtext		= record_cdtext,
+	.rem		= record_rem
+};
+
+// put the string of an event in the token buffer, with its span if it had one
+static const char *event_value(const struct EventLog *log, const struct Event *event, struct Parser *parser)
+{
+	if (!event->span)
+		return parser_string(parser, log->strings + event->str, event->len);
+	parser_string(parser, event->span, event->len);
+	parser->span = event->span;
+	parser->span_len = event->len;
+	return parser->buffer;
+}
+
+int event_log_replay(const struct EventLog *log, struct Parser *parser, const struct ParseEvents *events, void *data)
+{
+	const struct Event *event;
+	int status = 0, flags = parser->flags;
+	size_t n;
+
+	// strings are what the parse made of them
+	parser->flags &= ~PARSE_ENCODING;
+
+	for (n = 0; n < log->nevent && !status; n++) {
+		event = &log->event[n];
+		switch (event->type) {
+		case EVENT_CATALOG:
+			if (events->catalog)
+				status = events->catalog(data, event_value(log, event, parser));
+			break;
+		case EVENT_CDTEXTFILE:
+			if (events->cdtextfile)
+				status = events->cdtextfile(data, event_value(log, event, parser));
+			break;
+		case EVENT_DISC_MODE:
+			if (events->disc_mode)
+				status = events->disc_mode(data, event->i);
+			break;
+		case EVENT_TRACK:
+			if (events->track)
+				status = events->track(data, event->i, event->a, event->b);
+			break;
+		case EVENT_FLAG:
+			if (events->flag)
+				status = events->flag(data, event->i, event->a);
+			break;
+		case EVENT_ISRC:
+			if (events->isrc)
+				status = events->isrc(data, event_value(log, event, parser));
+			break;
+		case EVENT_FILE:
+			if (events->file)
+				status = events->file(data, event_value(log, event, parser), event->a, event->b);
+			break;
+		case EVENT_PREGAP:
+			if (events->pregap)
+				status = events->pregap(data, event->a);
+			break;
+		case EVENT_INDEX:
+			if (events->index)
+				status = events->index(data, event->i, event->a);
+			break;
+		case EVENT_POSTGAP:
+			if (events->postgap)
+				status = events->postgap(data, event->a);
+			break;
+		case EVENT_CDTEXT:
+			if (events->cdtext)
+				status = events->cdtext(data, event->i, event_value(log, event, parser));
+			break;
+		case EVENT_REM:
+			if (events->rem)
+				status = events->rem(data, event->i, event_value(log, event, parser));
+			break;
+		}
+	}
+	parser->flags = flags;
+	return status;
+}
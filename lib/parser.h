@@ -0,0 +1,188 @@
+/*
+ * parser.h -- reentrant parser context (parser.c, *_parse.y, *_scan.l)
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cd.h"
+#include "stats.h"
+
+// start conditions of the hand-written CUE scanner, as in cue_scan.l
+enum LexState {
+	LEX_INITIAL,
+	LEX_NAME,
+	LEX_REM,
+	LEX_RPG,
+	LEX_SKIP,
+	LEX_KEEP = -1	// keyword does not change the start condition
+};
+
+struct Parser {
+	void		*cue_scanner,	// reentrant flex scanners (cue_scan.l)
+			*toc_scanner;	// (toc_scan.l)
+	int		flags;		// enum ParseFlag options
+	int		last_track,	// parser_set_last_track()
+			nthread;	// parser_set_threads()
+	size_t		max_size;	// parser_set_max_size()
+	const struct Allocator *allocator;	// for the parser, its scanners and discs
+
+	/* input, read by parser_read() */
+	FILE		*fp;		// input file, NULL for memory input
+	const char	*str;		// memory input, not NUL terminated
+	size_t		len,		// length of memory input
+			pos;		// read position in memory input, or bytes read from fp
+	char		*input;		// UTF-16 input in UTF-8, read instead (PARSE_ENCODING)
+	enum Encoding	encoding;	// parser_get_encoding()
+	void		*transcoder;	// of strings of a code page to UTF-8, or NULL
+
+	/* hand-written CUE scanner state (cue_lex.c) */
+	const char	*lex_tok,	// start of the last token
+			*lex_cur,	// scan position in memory input
+			*lex_stop;	// end of a chunk (PARSE_PARALLEL), or NULL
+	enum LexState	lex_state;
+	bool		lex_bol,	// at beginning of line
+			lex_error;	// scanners disagree (PARSE_LEX_CHECK), or
+					// a chunk does not end at a line start
+	struct Spans	*spans;		// of the statement, for parser_cue_sheet(), or NULL
+
+	/* event callbacks (EMIT) */
+	const struct ParseEvents *events;
+	void		*data;
+	int		status,		// value of the callback that stopped the parse
+			nerror;		// calls of yyerror()
+	bool		quiet;		// count them, report nothing
+	int		ntrack,		// TOC track number
+			nindex;		// TOC index number
+	bool		track_file;	// TOC file statement in this track
+
+	/* struct Cd builder state (build_*()) */
+	bool		done;		// past the last track, accept what there is
+	int		reuse_track;	// track the next track event clears instead of adding one, or 0
+	struct Cd	*cd;
+	struct Track	*track,
+			*prev_track;
+	struct Cdtext	*cdtext;
+	char		*prev_filename,	// last file in or before last track
+			*cur_filename,	// last file in the last track
+			*new_filename;	// last file in this track
+	char		fnamebuf[PARSER_BUFFER],
+			buffer[PARSER_BUFFER];	// last STRING token
+	const char	*span;		// the same in the memory input, or NULL
+	size_t		span_len;
+};
+
+// call an event callback from a grammar action, stop the parse if it says so
+#define EMIT(event, ...)						\
+	do {								\
+		STATS_ADD(statements, 1);				\
+		if (parser->events->event				\
+		    && (parser->status = parser->events->event(parser->data, __VA_ARGS__))) \
+			YYABORT;					\
+		if (parser->done)					\
+			YYACCEPT;					\
+	} while (0)
+
+// spans of the tokens of the CUE statement parsed, for events (parser_cue_sheet())
+struct Spans {
+	const char	*tok[3],	// start of the first tokens
+			*prev_end,	// end of the token before the last
+			*last_end,	// end of the last token
+			*string,	// last STRING token, quotes included
+			*string_end;
+	int		ntok;		// tokens so far
+	bool		newline;	// the last token ended the statement
+};
+
+// parse events recorded with their strings, replayed later (PARSE_PARALLEL)
+enum EventType {
+	EVENT_CATALOG,
+	EVENT_CDTEXTFILE,
+	EVENT_DISC_MODE,
+	EVENT_TRACK,
+	EVENT_FLAG,
+	EVENT_ISRC,
+	EVENT_FILE,
+	EVENT_PREGAP,
+	EVENT_INDEX,
+	EVENT_POSTGAP,
+	EVENT_CDTEXT,
+	EVENT_REM
+};
+
+struct Event {
+	enum EventType	type;
+	int		i;		// number, flag, index, mode, PTI or REM
+	long		a,		// track mode, set, start, length or index
+			b;		// track sub-mode or file length
+	const char	*span;		// string in the memory input, or NULL
+	size_t		str,		// else its offset in the strings of the log
+			len;
+};
+
+struct EventLog {
+	struct Parser	*parser;	// that records
+	struct Event	*event;
+	size_t		nevent,
+			size;
+	char		*strings;	// copies of strings without a span
+	size_t		nstrings,
+			strings_size;
+	bool		copy;		// copy all strings, for input that changes
+};
+
+extern const struct ParseEvents event_log_record;	// data is a struct EventLog
+
+void event_log_init(struct EventLog *log, struct Parser *parser);
+void event_log_free(struct EventLog *log);
+// call events in the recorded order, with strings in the token buffer of parser as in a parse
+int event_log_replay(const struct EventLog *log, struct Parser *parser, const struct ParseEvents *events, void *data);
+
+// forget the last parse and read from fp or the len bytes at buf
+void parser_input_file(struct Parser *parser, FILE *fp);
+void parser_input_buffer(struct Parser *parser, const char *buf, size_t len);
+// the encoding of strings in the len bytes at buf, ENCODING_ASCII if none is needed
+enum Encoding parser_guess_encoding(const struct Parser *parser, const char *buf, size_t len);
+// read strings in encoding, guessed from all the input the parser reads a part of
+void parser_set_encoding(struct Parser *parser, enum Encoding encoding);
+
+// new struct Cd for the builder, in an arena with PARSE_ARENA
+struct Cd *parser_cd_init(struct Parser *parser);
+
+// fill scanner buffer from the current input, return number of bytes read
+size_t parser_read(struct Parser *parser, char *buf, size_t max);
+
+// copy a STRING token to the token buffer, truncate if too long
+char *parser_string(struct Parser *parser, const char *s, size_t len);
+// the same for a token in the memory input, which a lazy disc may point to
+char *parser_string_span(struct Parser *parser, const char *s, size_t len);
+
+// struct Cd builder callbacks shared by cue_parse.y and toc_parse.y, data is the parser
+int build_catalog(void *data, const char *catalog);
+int build_cdtextfile(void *data, const char *cdtextfile);
+int build_disc_mode(void *data, enum DiscMode mode);
+int build_flag(void *data, enum TrackFlag flag, int set);
+int build_isrc(void *data, const char *isrc);
+int build_pregap(void *data, long length);
+int build_postgap(void *data, long length);
+int build_cdtext(void *data, enum Pti pti, const char *value);
+int build_rem(void *data, enum Rem rem, const char *value);
+
+// cue_scan.l
+int cue_yylex_init_extra(struct Parser *parser, void **scanner);
+int cue_yylex_destroy(void *scanner);
+int cue_yyget_lineno(void *scanner);
+void cue_scan_reset(void *scanner);
+
+// toc_scan.l
+int toc_yylex_init_extra(struct Parser *parser, void **scanner);
+int toc_yylex_destroy(void *scanner);
+int toc_yyget_lineno(void *scanner);
+void toc_scan_reset(void *scanner);
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * sector.c -- where the tracks of a disc are in their data files
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cd.h"
+
+#define SAMPLE_SIZE	4	// bytes of a 16 bit stereo sample, 588 in a 2352 byte frame
+
+// end of the track before in the file of the next, -1 bytes if unknown
+struct Position {
+	const char	*name;
+	long		frame;
+	long long	byte;
+};
+
+int track_get_block_size(const struct Track *track)
+{
+	switch (track_get_mode(track)) {
+	case MODE_MODE1:
+	case MODE_MODE2_FORM1:
+		return 2048;
+	case MODE_MODE2:
+		return 2336;
+	case MODE_MODE2_FORM2:
+		return 2324;
+	case MODE_MODE2_FORM_MIX:
+		return 2332;
+	default:	// MODE_AUDIO, MODE_MODE1_RAW, MODE_MODE2_RAW
+		return 2352;
+	}
+}
+
+/*
+ * A CUE track starts at its first index in the file, so a pregap in the file
+ * belongs to it, and ends where the next one starts.  A TOC track is the part
+ * of the file it gives, a DATAFILE without start goes on after the track
+ * before.  Frames in between have the block size of the track after them.
+ */
+static void place(const struct Cd *cd, const struct Track *track, struct Position *pos, long long *offset, long long *size)
+{
+	const char *name = track_get_filename(track);
+	long start, length, idx00, idx01;
+	int block = track_get_block_size(track);
+
+	*offset = *size = -1;
+	if (!name) {
+		pos->name = NULL;
+		return;
+	}
+	if (!pos->name || strcmp(name, pos->name)) {
+		pos->name = name;
+		pos->frame = 0;
+		pos->byte = 0;
+	}
+
+	if (TOC == cd_get_format(cd)) {
+		if ((start = track_get_start(track)) == -1)
+			start = pos->frame;
+		length = track_get_length(track);
+	} else {
+		idx00 = track_get_index(track, 0);
+		if ((idx01 = track_get_index(track, 1)) == -1) {
+			pos->byte = -1;
+			return;
+		}
+		// an INDEX 00 after INDEX 01 is in the file before
+		start = idx00 != -1 && idx00 <= idx01 ? idx00 : idx01;
+		length = track_get_length(track) == -1 ? -1 : idx01 + track_get_length(track) - start;
+	}
+
+	if (start >= pos->frame) {
+		if (pos->byte != -1)
+			*offset = pos->byte + (long long)(start - pos->frame) * block;
+	} else
+		*offset = (long long)start * block;	// back to an earlier part of the file
+	if (length >= 0)
+		*size = (long long)length * block;
+	pos->frame = length >= 0 ? start + length : start;
+	pos->byte = *offset != -1 && *size != -1 ? *offset + *size : -1;
+}
+
+int cd_get_track_ranges(const struct Cd *cd, long long *offset, long long *size, long long *sample)
+{
+	struct Position pos = {NULL, 0, 0};
+	const struct Track *track;
+	long long o, s;
+	int i;
+
+	for (i = 1; i <= cd_get_ntrack(cd); i++) {
+		track = cd_get_track(cd, i);
+		place(cd, track, &pos, &o, &s);
+		if (offset)
+			offset[i - 1] = o;
+		if (size)
+			size[i - 1] = s;
+		if (sample)
+			sample[i - 1] = MODE_AUDIO == track_get_mode(track) && o != -1 ? o / SAMPLE_SIZE : -1;
+	}
+	return cd_get_ntrack(cd);
+}
+
+// the tracks before i tell where it is, so walk them as cd_get_track_ranges() does
+static void range(const struct Cd *cd, int i, long long *offset, long long *size)
+{
+	struct Position pos = {NULL, 0, 0};
+	int n;
+
+	*offset = *size = -1;
+	if (i < 1 || i > cd_get_ntrack(cd))
+		return;
+	for (n = 1; n <= i; n++)
+		place(cd, cd_get_track(cd, n), &pos, offset, size);
+}
+
+long long cd_get_track_offset(const struct Cd *cd, int i)
+{
+	long long offset, size;
+
+	range(cd, i, &offset, &size);
+	return offset;
+}
+
+long long cd_get_track_size(const struct Cd *cd, int i)
+{
+	long long offset, size;
+
+	range(cd, i, &offset, &size);
+	return size;
+}
+
+long long cd_get_track_sample(const struct Cd *cd, int i)
+{
+	long long offset = cd_get_track_offset(cd, i);
+
+	if (offset == -1 || MODE_AUDIO != track_get_mode(cd_get_track(cd, i)))
+		return -1;
+	return offset / SAMPLE_SIZE;
+}
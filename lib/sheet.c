@@ -0,0 +1,329 @@
+/*
+ * sheet.c -- lossless CUE sheet: statements as spans of the input, edited in place
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mem.h"
+#include "parser.h"
+#include "time.h"
+
+struct Statement {
+	enum EventType	type;
+	int		track,		// 0 for the disc
+			i;		// PTI, REM or index number
+	const char	*start,		// whole lines
+			*end,
+			*value,		// value token, quotes included, or NULL
+			*value_end;
+	char		*patch;		// written instead of the value token, or NULL
+};
+
+struct Sheet {
+	const struct Allocator *allocator;
+	const char	*buf;
+	size_t		len;
+	struct Statement *stmt;		// in input order
+	int		nstmt,
+			size,
+			ntrack;
+	struct Spans	spans;		// of the statement being parsed
+};
+
+static struct Statement *add(struct Sheet *sheet, enum EventType type, int i, const char *value, const char *value_end)
+{
+	struct Spans *spans = &sheet->spans;
+	const char *end = sheet->buf + sheet->len;
+	struct Statement *stmt = sheet->stmt;
+	int size;
+
+	if (sheet->nstmt == sheet->size) {
+		size = sheet->size ? 2 * sheet->size : 64;
+		if (!(stmt = mem_realloc(sheet->allocator, stmt, size * sizeof(*stmt))))
+			return NULL;
+		sheet->stmt = stmt;
+		sheet->size = size;
+	}
+	stmt = &sheet->stmt[sheet->nstmt++];
+	stmt->type = type;
+	stmt->track = sheet->ntrack;
+	stmt->i = i;
+	// from the line start before REM or blanks to the end of the line
+	for (stmt->start = spans->tok[0]; stmt->start > sheet->buf && '\n' != stmt->start[-1]; stmt->start--)
+		;
+	if (spans->newline)
+		stmt->end = spans->last_end;
+	else if ((stmt->end = memchr(spans->last_end, '\n', end - spans->last_end)))
+		stmt->end++;
+	else
+		stmt->end = end;
+	stmt->value = value;
+	stmt->value_end = value_end;
+	stmt->patch = NULL;
+	return stmt;
+}
+
+// statement with the value of the last STRING token
+static int add_string(void *data, enum EventType type, int i)
+{
+	struct Sheet *sheet = data;
+
+	return add(sheet, type, i, sheet->spans.string, sheet->spans.string_end) ? 0 : -1;
+}
+
+// statement with the time from token n on
+static int add_time(void *data, enum EventType type, int i, int n)
+{
+	struct Sheet *sheet = data;
+
+	return add(sheet, type, i, sheet->spans.tok[n], sheet->spans.prev_end) ? 0 : -1;
+}
+
+static int record_catalog(void *data, const char *catalog)
+{
+	return add_string(data, EVENT_CATALOG, 0);
+}
+
+static int record_cdtextfile(void *data, const char *cdtextfile)
+{
+	return add_string(data, EVENT_CDTEXTFILE, 0);
+}
+
+static int record_track(void *data, int number, enum TrackMode mode, enum TrackSubMode sub_mode)
+{
+	struct Sheet *sheet = data;
+
+	sheet->ntrack++;
+	return add(sheet, EVENT_TRACK, number, NULL, NULL) ? 0 : -1;
+}
+
+// one statement for all flags of a FLAGS line
+static int record_flag(void *data, enum TrackFlag flag, int set)
+{
+	struct Sheet *sheet = data;
+	struct Statement *last = sheet->nstmt ? &sheet->stmt[sheet->nstmt - 1] : NULL;
+
+	if (last && EVENT_FLAG == last->type && last->end > sheet->spans.tok[0])
+		return 0;
+	return add(sheet, EVENT_FLAG, 0, NULL, NULL) ? 0 : -1;
+}
+
+static int record_isrc(void *data, const char *isrc)
+{
+	return add_string(data, EVENT_ISRC, 0);
+}
+
+static int record_file(void *data, const char *name, long start, long length)
+{
+	return add_string(data, EVENT_FILE, 0);
+}
+
+static int record_pregap(void *data, long length)
+{
+	return add_time(data, EVENT_PREGAP, 0, 1);
+}
+
+static int record_index(void *data, int i, long index)
+{
+	return add_time(data, EVENT_INDEX, i, 2);
+}
+
+static int record_postgap(void *data, long length)
+{
+	return add_time(data, EVENT_POSTGAP, 0, 1);
+}
+
+static int record_cdtext(void *data, enum Pti pti, const char *value)
+{
+	return add_string(data, EVENT_CDTEXT, pti);
+}
+
+static int record_rem(void *data, enum Rem rem, const char *value)
+{
+	return add_string(data, EVENT_REM, rem);
+}
+
+static const struct ParseEvents record = {
+	.catalog	= record_catalog,
+	.cdtextfile	= record_cdtextfile,
+	.track		= record_track,
+	.flag		= record_flag,
+	.isrc		= record_isrc,
+	.file		= record_file,
+	.pregap		= record_pregap,
+	.index		= record_index,
+	.postgap	= record_postgap,
+	.cdtext		= record_cdtext,
+	.rem		= record_rem
+};
+
+struct Sheet *parser_cue_sheet(struct Parser *parser, const char *buf, size_t len)
+{
+	struct Sheet *sheet = mem_calloc(parser->allocator, sizeof(*sheet));
+	int flags = parser->flags, status;
+
+	if (!sheet)
+		return NULL;
+	sheet->allocator = parser->allocator;
+	sheet->buf = buf;
+	sheet->len = len;
+
+	// token spans come from the hand-written scanner, of the input as it is
+	parser->flags = (flags | PARSE_FAST_LEX) & ~(PARSE_LEX_CHECK | PARSE_ENCODING);
+	parser->spans = &sheet->spans;
+	status = parser_cue_buffer_events(parser, buf, len, &record, sheet);
+	parser->spans = NULL;
+	parser->flags = flags;
+
+	if (status) {
+		sheet_free(sheet);
+		return NULL;
+	}
+	return sheet;
+}
+
+void sheet_free(struct Sheet *sheet)
+{
+	int i;
+
+	if (!sheet)
+		return;
+	for (i = 0; i < sheet->nstmt; i++)
+		mem_free(sheet->allocator, sheet->stmt[i].patch);
+	mem_free(sheet->allocator, sheet->stmt);
+	mem_free(sheet->allocator, sheet);
+}
+
+// the last statement of a type, as the last one is what a parse keeps
+static struct Statement *find(const struct Sheet *sheet, enum EventType type, int track, int i)
+{
+	int n;
+
+	for (n = sheet->nstmt - 1; n >= 0; n--)
+		if (sheet->stmt[n].type == type && sheet->stmt[n].track == track && sheet->stmt[n].i == i)
+			return &sheet->stmt[n];
+	return NULL;
+}
+
+static struct Statement *find_file(const struct Sheet *sheet, int i)
+{
+	int n;
+
+	for (n = 0; n < sheet->nstmt; n++)
+		if (EVENT_FILE == sheet->stmt[n].type && !i--)
+			return &sheet->stmt[n];
+	return NULL;
+}
+
+static bool is_quote(char c)
+{
+	return '"' == c || '\'' == c;
+}
+
+static int patch(struct Sheet *sheet, struct Statement *stmt, const char *text, size_t len)
+{
+	char *p = mem_malloc(sheet->allocator, len + 1);
+
+	if (!p)
+		return -1;
+	memcpy(p, text, len);
+	p[len] = '\0';
+	mem_free(sheet->allocator, stmt->patch);
+	stmt->patch = p;
+	return 0;
+}
+
+/*
+ * Keep the quotes of the old value, add them where a name would end or be
+ * a comment.  Quoted strings have no escapes to write a quote or a trailing
+ * backslash with.
+ */
+static int set_string(struct Sheet *sheet, struct Statement *stmt, const char *value)
+{
+	char quote = is_quote(*stmt->value) ? *stmt->value : '\0', buf[PARSER_BUFFER + 2];
+	size_t len = strlen(value);
+
+	if (len >= PARSER_BUFFER || strchr(value, '\n'))
+		return -1;
+	if (!quote && (!len || strpbrk(value, " \t\r") || is_quote(*value) || ';' == *value))
+		quote = '"';
+	if (!quote)
+		return patch(sheet, stmt, value, len);
+	if (strchr(value, quote) || (len && '\\' == value[len - 1]))
+		return -1;
+	buf[0] = quote;
+	memcpy(buf + 1, value, len);
+	buf[len + 1] = quote;
+	return patch(sheet, stmt, buf, len + 2);
+}
+
+int sheet_get_nfile(const struct Sheet *sheet)
+{
+	int n, nfile = 0;
+
+	for (n = 0; n < sheet->nstmt; n++)
+		nfile += EVENT_FILE == sheet->stmt[n].type;
+	return nfile;
+}
+
+const char *sheet_get_file(const struct Sheet *sheet, int i, size_t *len)
+{
+	struct Statement *stmt = find_file(sheet, i);
+	const char *p;
+
+	if (!stmt) {
+		*len = 0;
+		return NULL;
+	}
+	p = stmt->patch ? stmt->patch : stmt->value;
+	*len = stmt->patch ? strlen(stmt->patch) : (size_t)(stmt->value_end - stmt->value);
+	if (*len >= 2 && is_quote(*p) && p[*len - 1] == *p) {
+		*len -= 2;
+		return p + 1;
+	}
+	return p;
+}
+
+int sheet_set_file(struct Sheet *sheet, int i, const char *name)
+{
+	struct Statement *stmt = find_file(sheet, i);
+
+	return stmt ? set_string(sheet, stmt, name) : -1;
+}
+
+int sheet_set_cdtext(struct Sheet *sheet, int track, enum Pti pti, const char *value)
+{
+	struct Statement *stmt = find(sheet, EVENT_CDTEXT, track, pti);
+
+	return stmt ? set_string(sheet, stmt, value) : -1;
+}
+
+int sheet_set_index(struct Sheet *sheet, int track, int i, long index)
+{
+	struct Statement *stmt = find(sheet, EVENT_INDEX, track, i);
+	char buf[32];
+	int m, s, f;
+
+	if (!stmt || index < 0)
+		return -1;
+	time_frame_to_msf(index, &m, &s, &f);
+	return patch(sheet, stmt, buf, snprintf(buf, sizeof(buf), "%02d:%02d:%02d", m, s, f));
+}
+
+int sheet_print(FILE *fp, const struct Sheet *sheet)
+{
+	const char *p = sheet->buf;
+	int n;
+
+	for (n = 0; n < sheet->nstmt; n++)
+		if (sheet->stmt[n].patch) {
+			fwrite(p, 1, sheet->stmt[n].value - p, fp);
+			fputs(sheet->stmt[n].patch, fp);
+			p = sheet->stmt[n].value_end;
+		}
+	fwrite(p, 1, sheet->buf + sheet->len - p, fp);
+	return ferror(fp) ? -1 : 0;
+}
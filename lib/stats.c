@@ -0,0 +1,69 @@
+/*
+ * stats.c -- parse and print statistics of the calling thread
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>	// <time.h> is time.h of this directory
+
+#include "stats.h"
+
+bool stats_enabled;
+_Thread_local struct Stats thread_stats;
+
+void cue_stats_enable(int enable)
+{
+	stats_enabled = enable;
+}
+
+void cue_stats_get(struct Stats *stats)
+{
+	*stats = thread_stats;
+}
+
+void cue_stats_reset(void)
+{
+	memset(&thread_stats, 0, sizeof(thread_stats));
+}
+
+void cue_stats_print(FILE *fp, const struct Stats *stats)
+{
+	fprintf(fp, "bytes scanned\t%lu\n"
+		    "tokens\t\t%lu\n"
+		    "statements\t%lu\n"
+		    "syntax errors\t%lu\n"
+		    "allocations\t%lu (%lu bytes)\n"
+		    "lex time\t%lu us\n"
+		    "parse time\t%lu us\n"
+		    "print time\t%lu us\n",
+		stats->bytes, stats->tokens, stats->statements, stats->errors,
+		stats->allocs, stats->alloc_bytes,
+		stats->lex_usec, stats->parse_usec, stats->print_usec);
+}
+
+/*
+ * A microsecond clock is coarse for a single token, but the sum over many
+ * is still right on average.
+ */
+unsigned long stats_usec(void)
+{
+	struct timeval tv;
+
+	if (!stats_enabled)
+		return 0;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000ul + tv.tv_usec;
+}
+
+void stats_add(struct Stats *to, const struct Stats *from)
+{
+	unsigned long *t = (unsigned long *)to;
+	const unsigned long *f = (const unsigned long *)from;
+	size_t i;
+
+	// all counters are unsigned long
+	for (i = 0; i < sizeof(*to) / sizeof(*t); i++)
+		__sync_fetch_and_add(&t[i], f[i]);
+}
@@ -0,0 +1,34 @@
+/*
+ * stats.h -- parse and print statistics of the calling thread
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+
+#include "libcue.h"
+
+extern bool stats_enabled;			// cue_stats_enable()
+extern _Thread_local struct Stats thread_stats;
+
+// count while enabled, at the cost of one branch otherwise
+#define STATS_ADD(counter, n)						\
+	do {								\
+		if (stats_enabled)					\
+			thread_stats.counter += (n);			\
+	} while (0)
+
+// add the microseconds since start, a stats_usec() value, to a *_usec counter
+#define STATS_TIME(counter, start)					\
+	do {								\
+		if (stats_enabled && (start))				\
+			thread_stats.counter += stats_usec() - (start);	\
+	} while (0)
+
+unsigned long stats_usec(void);		// 0 while disabled
+void stats_add(struct Stats *to, const struct Stats *from);	// atomic, to may be shared
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * timeline.c -- absolute frames of the tracks and indexes of a disc
+ *
+ * For license terms, see the file COPYING in this distribution.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cd.h"
+#include "mem.h"
+
+// start of an index, or of a pregap of zero data as index 0
+struct Point {
+	long	frame;
+	int	track,
+		index;
+};
+
+struct Timeline {
+	const struct Allocator *allocator;
+	struct Point	*point;		// by frame, equal frames in disc order
+	int		*first,		// point of each track
+			npoint,
+			size,		// of point
+			ntrack;
+	long		end;		// of the disc, -1 if unknown
+};
+
+static int add(struct Timeline *timeline, long frame, int track, int index)
+{
+	struct Point *point = timeline->point;
+	int size;
+
+	if (timeline->npoint && frame < point[timeline->npoint - 1].frame) {
+		fprintf(stderr, "track %d: index %d before the one before\n", track, index);
+		return -1;
+	}
+	if (timeline->npoint == timeline->size) {
+		size = timeline->size ? 2 * timeline->size : 2 * timeline->ntrack + 2;
+		if (!(point = mem_realloc(timeline->allocator, point, size * sizeof(*point))))
+			return -1;
+		timeline->point = point;
+		timeline->size = size;
+	}
+	point = &timeline->point[timeline->npoint++];
+	point->frame = frame;
+	point->track = track;
+	point->index = index;
+	return 0;
+}
+
+/*
+ * CUE indexes count from the start of their file, which starts where the
+ * file before ends.  PREGAP and POSTGAP zero data moves all that follows,
+ * PREGAP is index 0 of a track without INDEX 00.  An INDEX 00 after INDEX 01
+ * in a new file is a pregap at the end of the file before.
+ */
+static int build_cue(struct Timeline *timeline, const struct Cd *cd, long (*file_length)(void *data, const char *name), void *data)
+{
+	const struct Track *track;
+	const char *name = NULL, *prev;
+	long base = 0, prev_base = 0, length, pre, idx;
+	bool new_file;
+	int t, i;
+
+	for (t = 1; t <= timeline->ntrack; t++) {
+		track = cd_get_track(cd, t);
+		prev = name;
+		name = track_get_filename(track);
+		if (track_get_index(track, 1) == -1) {
+			fprintf(stderr, "track %d: no index 01\n", t);
+			return -1;
+		}
+		if ((new_file = t > 1 && (!name || !prev || strcmp(name, prev)))) {
+			if ((length = file_length && prev ? file_length(data, prev) : -1) < 0) {
+				fprintf(stderr, "%s: unknown length\n", prev ? prev : "no file");
+				return -1;
+			}
+			prev_base = base;
+			base += length;
+		}
+
+		timeline->first[t - 1] = timeline->npoint;
+		if (track_get_index(track, 0) == -1 && (pre = track_get_zero_pre(track)) > 0) {
+			if (add(timeline, base + track_get_index(track, 1), t, 0))
+				return -1;
+			base += pre;
+		}
+		for (i = 0; i < track_get_nindex(track); i++)
+			if ((idx = track_get_index(track, i)) != -1
+			    && add(timeline, (!i && new_file && idx > track_get_index(track, 1) ? prev_base : base) + idx, t, i))
+				return -1;
+		if (track_get_zero_post(track) > 0)
+			base += track_get_zero_post(track);
+	}
+	length = file_length && name ? file_length(data, name) : -1;
+	timeline->end = length < 0 ? -1 : base + length;
+	return 0;
+}
+
+/*
+ * TOC indexes count from the start of their track, which holds its zero
+ * data and the part of a file the sheet gives.  Only the last one may run
+ * to an unknown end of its file.
+ */
+static int build_toc(struct Timeline *timeline, const struct Cd *cd, long (*file_length)(void *data, const char *name), void *data)
+{
+	const struct Track *track;
+	const char *name;
+	long pos = 0, length, start;
+	int t, i;
+
+	for (t = 1; t <= timeline->ntrack; t++) {
+		track = cd_get_track(cd, t);
+		name = track_get_filename(track);
+		timeline->first[t - 1] = timeline->npoint;
+		for (i = 0; i < track_get_nindex(track); i++)
+			if (track_get_index(track, i) != -1 && add(timeline, pos + track_get_index(track, i), t, i))
+				return -1;
+		if ((length = track_get_length(track)) < 0) {
+			start = track_get_start(track) < 0 ? 0 : track_get_start(track);
+			length = file_length && name ? file_length(data, name) : -1;
+			if (length >= 0)
+				length = length > start ? length - start : 0;
+			else if (t < timeline->ntrack) {
+				fprintf(stderr, "%s: unknown length\n", name ? name : "no file");
+				return -1;
+			} else {
+				timeline->end = -1;
+				return 0;
+			}
+		}
+		if (track_get_zero_pre(track) > 0)
+			pos += track_get_zero_pre(track);
+		if (track_get_zero_post(track) > 0)
+			pos += track_get_zero_post(track);
+		pos += length;
+	}
+	timeline->end = pos;
+	return 0;
+}
+
+struct Timeline *cd_timeline(const struct Cd *cd, long (*file_length)(void *data, const char *name), void *data)
+{
+	const struct Allocator *allocator = cd_get_allocator(cd);
+	struct Timeline *timeline = mem_calloc(allocator, sizeof(*timeline));
+	int status;
+
+	if (!timeline)
+		return NULL;
+	timeline->allocator = allocator;
+	timeline->ntrack = cd_get_ntrack(cd);
+	if (timeline->ntrack && !(timeline->first = mem_malloc(allocator, timeline->ntrack * sizeof(*timeline->first)))) {
+		timeline_free(timeline);
+		return NULL;
+	}
+	if (TOC == cd_get_format(cd))
+		status = build_toc(timeline, cd, file_length, data);
+	else
+		status = build_cue(timeline, cd, file_length, data);
+	if (status) {
+		timeline_free(timeline);
+		return NULL;
+	}
+	return timeline;
+}
+
+void timeline_free(struct Timeline *timeline)
+{
+	if (!timeline)
+		return;
+	mem_free(timeline->allocator, timeline->point);
+	mem_free(timeline->allocator, timeline->first);
+	mem_free(timeline->allocator, timeline);
+}
+
+long timeline_get_length(const struct Timeline *timeline)
+{
+	return timeline->end;
+}
+
+long timeline_get_start(const struct Timeline *timeline, int track)
+{
+	if (track < 1 || track > timeline->ntrack)
+		return -1;
+	return timeline->point[timeline->first[track - 1]].frame;
+}
+
+long timeline_get_end(const struct Timeline *timeline, int track)
+{
+	if (track < 1 || track > timeline->ntrack)
+		return -1;
+	return track < timeline->ntrack ? timeline_get_start(timeline, track + 1) : timeline->end;
+}
+
+long timeline_get_index(const struct Timeline *timeline, int track, int i)
+{
+	int n, last;
+
+	if (track < 1 || track > timeline->ntrack)
+		return -1;
+	last = track < timeline->ntrack ? timeline->first[track] : timeline->npoint;
+	for (n = timeline->first[track - 1]; n < last; n++)
+		if (timeline->point[n].index == i)
+			return timeline->point[n].frame;
+	return -1;
+}
+
+// the last point at or before frame
+int timeline_find(const struct Timeline *timeline, long frame, int *index)
+{
+	int lo = 0, hi = timeline->npoint, mid;
+
+	if (frame < 0 || (timeline->end != -1 && frame >= timeline->end))
+		return 0;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (timeline->point[mid].frame <= frame)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo)
+		return 0;
+	if (index)
+		*index = timeline->point[lo - 1].index;
+	return timeline->point[lo - 1].track;
+}
@@ -13,18 +13,21 @@
 #include "cd.h"
 #include "cdtext.h"
 #include "time.h"
+#include "mem.h"
+#include "parser.h"
 #include "toc_parse_prefix.h"
 
 #define YYDEBUG 1
+#define YYMALLOC(size)	mem_malloc(parser->allocator, size)	// stack growth
+#define YYFREE(ptr)	mem_free(parser->allocator, ptr)
 
-extern int yylex();
-void yyerror (char *s);
-
-static struct Cd *cd = NULL;
-static struct Track *track = NULL;
-static struct Cdtext *cdtext = NULL;
+void yyerror(struct Parser *, const char *);
 %}
 
+%define api.pure full
+%parse-param {struct Parser *parser}
+%lex-param {struct Parser *parser}
+
 %start tocfile
 
 %union {
@@ -91,7 +94,6 @@ static struct Cdtext *cdtext = NULL;
 %token <ival> SIZE_INFO
 
 %type <ival> disc_mode
-%type <ival> track_modes
 %type <ival> track_mode
 %type <ival> track_sub_mode
 %type <ival> track_set_flag
@@ -99,17 +101,23 @@ static struct Cdtext *cdtext = NULL;
 %type <ival> time
 %type <ival> cdtext_item
 
+%{
+int toc_scan(YYSTYPE *, void *);	// toc_scan.l
+
+static int yylex(YYSTYPE *lval, struct Parser *parser)
+{
+	unsigned long start = stats_usec();
+	int token = toc_scan(lval, parser->toc_scanner);
+
+	STATS_ADD(tokens, 1);
+	STATS_TIME(lex_usec, start);
+	return token;
+}
+%}
 %%
 
 tocfile
-	: new_cd global_statements track_list
-	;
-
-new_cd
-	: /* empty */ {
-		cd = cd_init();
-		cdtext = cd_get_cdtext(cd);
-	}
+	: global_statements track_list
 	;
 
 global_statements
@@ -118,8 +126,8 @@ global_statements
 	;
 
 global_statement
-	: CATALOG STRING '\n' { cd_set_catalog(cd, $2); }
-	| disc_mode '\n' { cd_set_mode(cd, $1); }
+	: CATALOG STRING '\n' { EMIT(catalog, $2); }
+	| disc_mode '\n' { EMIT(disc_mode, $1); }
 	| CD_TEXT '{' opt_nl language_map cdtext_langs '}' '\n'
 	| error '\n'
 	;
@@ -136,30 +144,22 @@ track_list
 	;
 
 track
-	: new_track track_def track_statements {
-		while (track_get_nindex(track) < 2)
-			track_add_index(track, 0);
+	: track_def track_statements {
+		while (parser->nindex < 2)
+			EMIT(index, parser->nindex++, 0);
 	}
 	;
 
-new_track
-	: /* empty */ {
-		track = cd_add_track(cd);
-		cdtext = track_get_cdtext(track);
+track_def
+	: TRACK track_mode track_sub_mode '\n' {
+		parser->nindex = 0;
+		parser->track_file = false;
+		EMIT(track, ++parser->ntrack, $2, $3);
 		/* add 0 index */
-		track_add_index(track, 0);
+		EMIT(index, parser->nindex++, 0);
 	}
 	;
 
-track_def
-	: TRACK track_modes '\n' { track_set_mode(track, $2); }
-	;
-
-track_modes
-	: track_mode
-	| track_mode track_sub_mode { track_set_sub_mode(track, $2); }
-	;
-
 track_mode
 	: AUDIO
 	| MODE1
@@ -171,8 +171,9 @@ track_mode
 	| MODE2_RAW
 	;
 
-track_sub_mode	
-	: RW
+track_sub_mode
+	: /* empty */ { $$ = SUB_MODE_RW; }
+	| RW
 	| RW_RAW
 	;
 
@@ -183,7 +184,7 @@ track_statements
 
 track_statement
 	: track_flags
-	| ISRC STRING '\n' { track_set_isrc(track, $2); }
+	| ISRC STRING '\n' { EMIT(isrc, $2); }
 	| CD_TEXT '{' opt_nl cdtext_langs '}' '\n'
 	| track_data
 	| track_pregap
@@ -192,8 +193,8 @@ track_statement
 	;
 
 track_flags
-	: track_set_flag { track_set_flag(track, $1); }
-	| track_clear_flag { track_clear_flag(track, $1); }
+	: track_set_flag { EMIT(flag, $1, 1); }
+	| track_clear_flag { EMIT(flag, $1, 0); }
 	;
 
 track_set_flag
@@ -210,30 +211,30 @@ track_clear_flag
 
 track_data
 	: zero_data time '\n' {
-		if (track_get_filename(track))
-			track_set_zero_post(track, $2);
+		if (parser->track_file)
+			EMIT(postgap, $2);
 		else
-			track_set_zero_pre(track, $2);
+			EMIT(pregap, $2);
 	}
 	| AUDIOFILE STRING time '\n' {
-		track_set_filename(track, $2);
-		track_set_start(track, $3);
+		parser->track_file = true;
+		EMIT(file, $2, $3, -1);
 	}
 	| AUDIOFILE STRING time time '\n' {
-		track_set_filename(track, $2);
-		track_set_start(track, $3);
-		track_set_length(track, $4);
+		parser->track_file = true;
+		EMIT(file, $2, $3, $4);
 	}
 	| DATAFILE STRING '\n' {
-		track_set_filename(track, $2);
+		parser->track_file = true;
+		EMIT(file, $2, -1, -1);
 	}
 	| DATAFILE STRING time '\n' {
-		track_set_filename(track, $2);
-		track_set_start(track, $3);
+		parser->track_file = true;
+		EMIT(file, $2, $3, -1);
 	}
 	| FIFO STRING time '\n' {
-		track_set_filename(track, $2);
-		track_set_start(track, $3);
+		parser->track_file = true;
+		EMIT(file, $2, $3, -1);
 	}
 	;
 
@@ -244,17 +245,15 @@ zero_data
 
 track_pregap
 	: START '\n'
-	| START time '\n' {
-		track_add_index(track, $2);
-	}
+	| START time '\n' { EMIT(index, parser->nindex++, $2); }
 	| PREGAP time '\n' {
-		track_set_zero_pre(track, $2);
-		track_add_index(track, $2);
+		EMIT(pregap, $2);
+		EMIT(index, parser->nindex++, $2);
 	}
 	;
 
 track_index
-	: INDEX time '\n' { track_add_index(track, $2); }
+	: INDEX time '\n' { EMIT(index, parser->nindex++, $2); }
 	;
 
 language_map
@@ -285,11 +284,9 @@ cdtext_defs
 	;
 
 cdtext_def
-	: cdtext_item STRING '\n' {
-		cdtext_set(cdtext, $1, $2);
-	}
+	: cdtext_item STRING '\n' { EMIT(cdtext, $1, $2); }
 	| cdtext_item '{' bytes '}' '\n' {
-		yyerror("binary CD-TEXT data not supported\n");
+		yyerror(parser, "binary CD-TEXT data not supported\n");
 	}
 	;
 
@@ -327,22 +324,169 @@ opt_nl
 %%
 
 /* lexer interface */
-extern int toc_lineno;
-extern int yydebug;
-extern FILE *toc_yyin;
 
-void yyerror (char *s)
+void yyerror(struct Parser *parser, const char *s)
 {
-	fprintf(stderr, "%d: %s\n", toc_lineno, s);
+	parser->nerror++;
+	if (parser->quiet)
+		return;
+	STATS_ADD(errors, 1);
+	fprintf(stderr, "%d: %s\n", toc_yyget_lineno(parser->toc_scanner), s);
+}
+
+/* struct Cd builder */
+
+static int build_track(void *data, int number, enum TrackMode mode, enum TrackSubMode sub_mode)
+{
+	struct Parser *parser = data;
+
+	// TOC tracks are complete when the next one starts
+	if (parser->last_track >= 0 && cd_get_ntrack(parser->cd) >= parser->last_track) {
+		parser->done = true;
+		return 0;
+	}
+	parser->track = cd_add_track(parser->cd);
+	parser->cdtext = track_get_cdtext(parser->track);
+	track_set_mode(parser->track, mode);
+	track_set_sub_mode(parser->track, sub_mode);
+	return 0;
+}
+
+static int build_file(void *data, const char *name, long start, long length)
+{
+	struct Parser *parser = data;
+
+	track_set_filename(parser->track, name);
+	if (start != -1)
+		track_set_start(parser->track, start);
+	if (length != -1)
+		track_set_length(parser->track, length);
+	return 0;
+}
+
+static int build_index(void *data, int i, long index)
+{
+	struct Parser *parser = data;
+
+	track_add_index(parser->track, index);
+	return 0;
+}
+
+static const struct ParseEvents build = {
+	.catalog	= build_catalog,
+	.disc_mode	= build_disc_mode,
+	.track		= build_track,
+	.flag		= build_flag,
+	.isrc		= build_isrc,
+	.file		= build_file,
+	.pregap		= build_pregap,
+	.index		= build_index,
+	.postgap	= build_postgap,
+	.cdtext		= build_cdtext
+};
+
+static int parse(struct Parser *parser, const struct ParseEvents *events, void *data)
+{
+	unsigned long start = stats_usec(), lex = thread_stats.lex_usec;
+	int status = 0;
+
+	parser->events	= events;
+	parser->data	= data;
+	if (yyparse(parser) || (parser->quiet && parser->nerror))
+		status = parser->status ? parser->status : -1;
+	// leave out the time in the scanner, it has its own counter
+	STATS_TIME(parse_usec, start + (thread_stats.lex_usec - lex));
+
+	parser_reset(parser);
+
+	return status;
+}
+
+static struct Cd *parse_cd(struct Parser *parser)
+{
+	struct Cd *cd = parser_cd_init(parser);
+
+	if (!cd) {
+		parser_reset(parser);
+		return NULL;
+	}
+	cd_set_format(cd, TOC);
+	if (parse(parser, &build, parser)) {
+		cd_free(cd);
+		return NULL;
+	}
+
+	return cd;
+}
+
+struct Cd *parser_toc_file(struct Parser *parser, FILE *fp)
+{
+	parser_input_file(parser, fp);
+
+	return parse_cd(parser);
+}
+
+struct Cd *parser_toc_buffer(struct Parser *parser, const char *buf, size_t len)
+{
+	parser_input_buffer(parser, buf, len);
+
+	return parse_cd(parser);
+}
+
+struct Cd *parser_toc_string(struct Parser *parser, const char *string)
+{
+	return parser_toc_buffer(parser, string, strlen(string));
+}
+
+int parser_toc_file_events(struct Parser *parser, FILE *fp, const struct ParseEvents *events, void *data)
+{
+	parser_input_file(parser, fp);
+
+	return parse(parser, events, data);
+}
+
+int parser_toc_buffer_events(struct Parser *parser, const char *buf, size_t len, const struct ParseEvents *events, void *data)
+{
+	parser_input_buffer(parser, buf, len);
+
+	return parse(parser, events, data);
 }
 
 struct Cd *toc_parse(FILE *fp)
 {
-	toc_yyin = fp;
-	yydebug = 0;
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_toc_file(parser, fp);
+		parser_free(parser);
+	}
+
+	return cd;
+}
 
-	if (0 == yyparse())
-		return cd;
+struct Cd *toc_parse_string(const char *string)
+{
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_toc_string(parser, string);
+		parser_free(parser);
+	}
+
+	return cd;
+}
+
+struct Cd *toc_parse_buffer(const char *buf, size_t len)
+{
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
+
+	if (parser) {
+		cd = parser_toc_buffer(parser, buf, len);
+		parser_free(parser);
+	}
 
-	return NULL;
+	return cd;
 }
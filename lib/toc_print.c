@@ -28,7 +28,8 @@ void toc_print_cdtext (struct Cdtext *cdtext, FILE *fp, int istrack)
 void toc_print_track (FILE *fp, struct Track *track)
 {
 	struct Cdtext *cdtext = track_get_cdtext(track);
-	int i;	/* index */
+	int	i,	/* index */
+		n;
 
 	fprintf(fp, "TRACK ");
 	switch (track_get_mode(track)) {
@@ -101,7 +102,7 @@ void toc_print_track (FILE *fp, struct Track *track)
 		fprintf(fp, "%s\n", time_frame_to_mmssff(track_get_index(track, 1)));
 	}
 
-	for (i = 2; i < track_get_nindex(track); i++) {
+	for (i = 2, n = track_get_nindex(track); i < n; i++) {
 		fprintf(fp, "INDEX ");
 		fprintf(fp, "%s\n", time_frame_to_mmssff( \
 		track_get_index(track, i) - track_get_index(track, 0) \
@@ -113,7 +114,8 @@ void toc_print (FILE *fp, struct Cd *cd)
 {
 	struct Cdtext *cdtext = cd_get_cdtext(cd);
 	struct Track *track;
-	int i;	/* track */
+	int	i,	/* track */
+		n = cd_get_ntrack(cd);
 
 	switch(cd_get_mode(cd)) {
 	case MODE_CD_DA:
@@ -139,7 +141,7 @@ void toc_print (FILE *fp, struct Cd *cd)
 		fprintf(fp, "}\n");
 	}
 
-	for (i = 1; i <= cd_get_ntrack(cd); i++) {
+	for (i = 1; i <= n; i++) {
 		track = cd_get_track(cd, i);
 		fprintf(fp, "\n");
 		toc_print_track(fp, track);
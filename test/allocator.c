@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static char cue[] =   "REM DATE 1991\n"
+                      "TITLE \"Loveless\"\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "INDEX 02 01:00:00\n"
+                      "INDEX 03 02:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE \"Loomer\"\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:52\n";
+
+struct Count {
+   long allocs, frees;
+};
+
+static void *count_malloc(void *data, size_t size)
+{
+   ((struct Count *)data)->allocs++;
+   return malloc(size);
+}
+
+static void *count_realloc(void *data, void *ptr, size_t size)
+{
+   if (!ptr)
+      ((struct Count *)data)->allocs++;
+   return realloc(ptr, size);
+}
+
+static void count_free(void *data, void *ptr)
+{
+   ((struct Count *)data)->frees++;
+   free(ptr);
+}
+
+static char* check_cd(struct Cd *cd)
+{
+   const char *val;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   val = cdtext_get(track_get_cdtext(cd_get_track(cd, 2)), PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "Loomer"));
+   val = rem_get(cd_get_cdtext(cd), REM_DATE);
+   mu_assert("error validating date", val && !strcmp(val, "1991"));
+   mu_assert("invalid index 03", track_get_index(cd_get_track(cd, 1), 3) == 2 * 60 * 75);
+   return NULL;
+}
+
+/* everything the parser and its discs allocate goes through the callbacks */
+static char* parser_test(int flag)
+{
+   struct Count count = {0, 0};
+   struct Allocator allocator = {count_malloc, count_realloc, count_free, &count};
+   struct Parser *parser = parser_init_allocator(&allocator);
+   struct Cd *cd;
+   char *message;
+   long allocs;
+
+   mu_assert("error creating parser", parser != NULL);
+   mu_assert("parser not allocated", count.allocs > 0);
+   parser_set_flag(parser, flag);
+   allocs = count.allocs;
+   cd = parser_cue_string(parser, cue);
+   message = check_cd(cd);
+   mu_assert("disc not allocated", count.allocs > allocs);
+   cd_free(cd);
+   parser_free(parser);
+   mu_assert("allocations not balanced", count.allocs == count.frees);
+   return message;
+}
+
+static char* heap_test()
+{
+   return parser_test(0);
+}
+
+static char* arena_test()
+{
+   return parser_test(PARSE_ARENA);
+}
+
+static char* process_test()
+{
+   struct Count count = {0, 0};
+   struct Allocator allocator = {count_malloc, count_realloc, count_free, &count};
+   struct Cd *cd;
+   char *message;
+
+   cue_set_allocator(&allocator);
+   cd = cue_parse_string(cue);
+   message = check_cd(cd);
+   cd_free(cd);
+   cue_set_allocator(NULL);
+   mu_assert("nothing allocated", count.allocs > 0);
+   mu_assert("allocations not balanced", count.allocs == count.frees);
+   return message;
+}
+
+static char* run_tests()
+{
+   mu_run_test (heap_test);
+   mu_run_test (arena_test);
+   mu_run_test (process_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static char toc[] =   "CD_DA\n"
+                      "CATALOG \"0123456789012\"\n"
+                      "CD_TEXT { LANGUAGE 0 { TITLE \"Loveless\" PERFORMER \"My Bloody Valentine\" } }\n"
+                      "TRACK AUDIO\n"
+                      "ISRC \"GBAAA9100001\"\n"
+                      "CD_TEXT { LANGUAGE 0 { TITLE \"Only Shallow\" } }\n"
+                      "FILE \"loveless.wav\" 0 04:17:52\n"
+                      "TRACK AUDIO\n"
+                      "CD_TEXT { LANGUAGE 0 { TITLE \"Loomer\" } }\n"
+                      "FILE \"loveless.wav\" 04:17:52\n";
+
+static int same(const char *a, const char *b)
+{
+   return a == b || (a && b && !strcmp(a, b));
+}
+
+/* an arena disc must read back exactly like a heap one */
+static char* compare(struct Cd *heap, struct Cd *arena)
+{
+   int i, j, n;
+
+   mu_assert("error parsing", heap != NULL && arena != NULL);
+   n = cd_get_ntrack(heap);
+   mu_assert("invalid number of tracks", cd_get_ntrack(arena) == n);
+   for (i = 0; i < PTI_SIZE; i++)
+      mu_assert("CD-TEXT differs", same(cdtext_get(cd_get_cdtext(heap), i),
+                                        cdtext_get(cd_get_cdtext(arena), i)));
+   for (i = 0; i < REM_SIZE; i++)
+      mu_assert("REM differs", same(rem_get(cd_get_cdtext(heap), i),
+                                    rem_get(cd_get_cdtext(arena), i)));
+   for (i = 1; i <= n; i++) {
+      struct Track *a = cd_get_track(heap, i),
+                   *b = cd_get_track(arena, i);
+
+      mu_assert("filename differs", same(track_get_filename(a), track_get_filename(b)));
+      mu_assert("ISRC differs", same(track_get_isrc(a), track_get_isrc(b)));
+      mu_assert("start differs", track_get_start(a) == track_get_start(b));
+      mu_assert("length differs", track_get_length(a) == track_get_length(b));
+      for (j = 0; j < 100; j++)
+         mu_assert("index differs", track_get_index(a, j) == track_get_index(b, j));
+      for (j = 0; j < PTI_SIZE; j++)
+         mu_assert("track CD-TEXT differs", same(cdtext_get(track_get_cdtext(a), j),
+                                                 cdtext_get(track_get_cdtext(b), j)));
+   }
+   cd_free(heap);
+   cd_free(arena);
+   return NULL;
+}
+
+static char* cue_arena_test()
+{
+   struct Parser *parser = parser_init();
+   struct Cd *heap, *arena;
+
+   mu_assert("error creating parser", parser != NULL);
+   FILE *fp = fopen("99_tracks.cue", "r");
+   assert(fp);
+   heap = parser_cue_file(parser, fp);
+   rewind(fp);
+   parser_set_flag(parser, PARSE_ARENA);
+   arena = parser_cue_file(parser, fp);
+   fclose(fp);
+   parser_free(parser);
+
+   return compare(heap, arena);
+}
+
+static char* toc_arena_test()
+{
+   struct Parser *parser = parser_init();
+   struct Cd *heap, *arena;
+
+   mu_assert("error creating parser", parser != NULL);
+   heap = parser_toc_string(parser, toc);
+   parser_set_flag(parser, PARSE_ARENA);
+   arena = parser_toc_string(parser, toc);
+   mu_assert("error validating ISRC", arena && !strcmp(track_get_isrc(cd_get_track(arena, 1)), "GBAAA9100001"));
+   parser_free(parser);
+
+   return compare(heap, arena);
+}
+
+static char* run_tests()
+{
+   mu_run_test (cue_arena_test);
+   mu_run_test (toc_arena_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
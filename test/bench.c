@@ -0,0 +1,99 @@
+/*
+ * bench.c -- time parsing, walking and printing a large sheet
+ *
+ * Built on request only: make bench
+ * usage: bench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "libcue.h"
+
+#define NTRACK	99	// Red Book limits
+#define NINDEX	99
+
+static double now()
+{
+   struct timeval tv;
+
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* every track with all its indexes */
+static char *make_sheet(size_t *len)
+{
+   size_t size = 64 + NTRACK * (64 + NINDEX * 24);
+   char *buf = malloc(size), *p = buf;
+   long frame = 0;
+   int t, i;
+
+   if (!buf)
+      return NULL;
+   p += sprintf(p, "TITLE \"Bench\"\nFILE \"bench.wav\" WAVE\n");
+   for (t = 1; t <= NTRACK; t++) {
+      p += sprintf(p, "TRACK %02d AUDIO\nTITLE \"Track %d\"\n", t, t);
+      for (i = 0; i < NINDEX; i++, frame += 30)
+         p += sprintf(p, "INDEX %02d %02ld:%02ld:%02ld\n", i,
+                      frame / (60 * 75), frame / 75 % 60, frame % 75);
+   }
+   *len = p - buf;
+   return buf;
+}
+
+/* visit every index the way a client of libcue.h does */
+static long walk(struct Cd *cd)
+{
+   long sum = 0;
+   int t, i;
+
+   for (t = 1; t <= cd_get_ntrack(cd); t++)
+      for (i = 0; i < NINDEX; i++)
+         sum += track_get_index(cd_get_track(cd, t), i);
+   return sum;
+}
+
+int main(int argc, char **argv)
+{
+   int rounds = argc > 1 ? atoi(argv[1]) : 100, r;
+   enum Format cue = CUE, toc = TOC;
+   struct Parser *parser = parser_init();
+   struct Cd *cd = NULL;
+   double t0, parse = 0, visit = 0, print = 0;
+   long sum = 0;
+   size_t len;
+   char *buf = make_sheet(&len);
+
+   if (!buf || !parser || rounds < 1)
+      return 1;
+   parser_set_flag(parser, PARSE_FAST_LEX);
+   for (r = 0; r < rounds; r++) {
+      cd_free(cd);
+      t0 = now();
+      cd = parser_cue_buffer(parser, buf, len);
+      parse += now() - t0;
+      if (!cd)
+         return 1;
+
+      t0 = now();
+      sum += walk(cd);
+      visit += now() - t0;
+
+      t0 = now();
+      cf_print("/dev/null", &cue, cd);
+      cf_print("/dev/null", &toc, cd);
+      print += now() - t0;
+   }
+   printf("%d tracks, %d indexes each, %zu bytes, checksum %ld\n", NTRACK, NINDEX, len, sum);
+   printf("parse\t%8.1f us\n", parse * 1e6 / rounds);
+   printf("walk\t%8.1f us\n", visit * 1e6 / rounds);
+   printf("print\t%8.1f us\n", print * 1e6 / rounds);
+
+   cd_free(cd);
+   parser_free(parser);
+   free(buf);
+   return 0;
+}
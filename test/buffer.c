@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* the first sheet ends at the last newline, the rest must not be read */
+static char cue[] =   "FILE \"My Bloody Valentine - Loveless.wav\" WAVE\n"
+                        "TRACK 01 AUDIO\n"
+                           "TITLE \"Only Shallow\"\n"
+                           "INDEX 01 00:00:00\n"
+                        "TRACK 02 AUDIO\n"
+                           "TITLE \"Loomer\"\n"
+                           "INDEX 01 04:17:52\n"
+                        "TRACK 03 AUDIO\n"
+                           "INDEX 01 06:58:35\n";
+
+static char toc[] =   "CD_DA\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 0 04:17:52\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 04:17:52\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 06:58:35";
+
+static char* cue_buffer_test()
+{
+   size_t len = strrchr(cue, 'T') - cue;
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+
+   cd = cue_parse_buffer(cue, len);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   cd_free(cd);
+
+   mu_assert("error creating parser", parser != NULL);
+   cd = parser_cue_buffer(parser, cue, len);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   cd_free(cd);
+
+   cd = parser_cue_buffer(parser, cue, sizeof(cue) - 1);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 3);
+   cd_free(cd);
+   parser_free(parser);
+
+   return NULL;
+}
+
+static char* toc_buffer_test()
+{
+   size_t len = strrchr(toc, 'T') - toc;
+   struct Cd *cd = toc_parse_buffer(toc, len);
+   mu_assert("error parsing TOC", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   cd_free(cd);
+
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (cue_buffer_test);
+   mu_run_test (toc_buffer_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
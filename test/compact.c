@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+/* indexes past the inline ones, CD-TEXT and REM set out of order and twice */
+static char cue[] =   "REM DATE 1991\n"
+                      "GENRE \"Shoegaze\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless (remastered)\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "INDEX 01 00:00:00\n"
+                      "INDEX 02 01:00:00\n"
+                      "INDEX 05 02:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "SONGWRITER \"Kevin Shields\"\n"
+                      "REM REPLAYGAIN_TRACK_PEAK 0.9\n"
+                      "TITLE \"Loomer\"\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:52\n";
+
+static char* compact_test()
+{
+   struct Cd *cd = cue_parse_string(cue);
+   struct Cdtext *cdtext;
+   struct Track *track;
+   const char *val;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   cdtext = cd_get_cdtext(cd);
+   val = cdtext_get(cdtext, PTI_TITLE);
+   mu_assert("error validating CD title", val && !strcmp(val, "Loveless (remastered)"));
+   val = cdtext_get(cdtext, PTI_PERFORMER);
+   mu_assert("error validating CD performer", val && !strcmp(val, "My Bloody Valentine"));
+   val = cdtext_get(cdtext, PTI_GENRE);
+   mu_assert("error validating CD genre", val && !strcmp(val, "Shoegaze"));
+   mu_assert("unset CD songwriter", cdtext_get(cdtext, PTI_SONGWRITER) == NULL);
+   val = rem_get(cdtext, REM_DATE);
+   mu_assert("error validating date", val && !strcmp(val, "1991"));
+   mu_assert("unset disc number", rem_get(cdtext, REM_DISCNUMBER) == NULL);
+
+   track = cd_get_track(cd, 1);
+   mu_assert("missing index 00", track_get_index(track, 0) == -1);
+   mu_assert("invalid index 01", track_get_index(track, 1) == 0);
+   mu_assert("invalid index 02", track_get_index(track, 2) == MSF_TO_F(1,0,0));
+   mu_assert("missing index 03", track_get_index(track, 3) == -1);
+   mu_assert("missing index 04", track_get_index(track, 4) == -1);
+   mu_assert("invalid index 05", track_get_index(track, 5) == MSF_TO_F(2,0,0));
+   mu_assert("missing index 06", track_get_index(track, 6) == -1);
+   mu_assert("missing index 99", track_get_index(track, 99) == -1);
+   mu_assert("unset track title", cdtext_get(track_get_cdtext(track), PTI_TITLE) == NULL);
+
+   track = cd_get_track(cd, 2);
+   mu_assert("invalid index 00", track_get_index(track, 0) == MSF_TO_F(4,15,52));
+   mu_assert("invalid index 01", track_get_index(track, 1) == MSF_TO_F(4,17,52));
+   mu_assert("missing index 02", track_get_index(track, 2) == -1);
+   cdtext = track_get_cdtext(track);
+   val = cdtext_get(cdtext, PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "Loomer"));
+   val = cdtext_get(cdtext, PTI_SONGWRITER);
+   mu_assert("error validating track songwriter", val && !strcmp(val, "Kevin Shields"));
+   val = rem_get(cdtext, REM_REPLAYGAIN_TRACK_PEAK);
+   mu_assert("error validating track peak", val && !strcmp(val, "0.9"));
+
+   mu_assert("no track 3", cd_get_track(cd, 3) == NULL);
+   cd_free(cd);
+
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (compact_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
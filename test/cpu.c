@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static const char *self;
+
+/* the features of this program run with LIBCUE_CPU=level, -1 on error */
+static int features_at(const char *level)
+{
+   char cmd[1024];
+   FILE *fp;
+   int features = -1;
+
+   if (snprintf(cmd, sizeof(cmd), "LIBCUE_CPU=%s '%s' features", level, self) >= (int)sizeof(cmd) || !(fp = popen(cmd, "r")))
+      return -1;
+   if (fscanf(fp, "%d", &features) != 1)
+      features = -1;
+   pclose(fp);
+   return features;
+}
+
+static char* selftest_test()
+{
+   mu_assert("vector kernels differ from scalar", cue_cpu_selftest(stderr) == 0);
+   return NULL;
+}
+
+/* a level is forced down, never up */
+static char* level_test()
+{
+   int features = cue_cpu_features(), x86 = features_at("avx512");
+
+   mu_assert("both x86 and ARM features", !(features & CPU_NEON) || !(features & ~CPU_NEON));
+   mu_assert("features of a lower level", !(features & CPU_AVX2) || (features & CPU_SSE2));
+   mu_assert("scalar not forced", features_at("scalar") == 0);
+   mu_assert("sse2 not forced", features_at("sse2") == (x86 & CPU_SSE2));
+   /* unless this program runs forced itself */
+   mu_assert("level raised", !(x86 & CPU_NEON) && (getenv("LIBCUE_CPU") || x86 == (features & ~CPU_NEON)));
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (selftest_test);
+   mu_run_test (level_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result;
+
+   if (argc > 1 && !strcmp(argv[1], "features")) {
+      printf ("%d\n", cue_cpu_features());
+      return 0;
+   }
+   self = argv[0];
+   result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+#define NTRACK	99
+
+static int eq(const char *a, const char *b)
+{
+   return a == b || (a && b && !strcmp(a, b));
+}
+
+/* tracks of a minute, a new file every 20 tracks, index 00 on every third */
+static char *make_cue(void)
+{
+   char *buf = malloc(256 + NTRACK * 128), *p = buf;
+   long frame;
+   int i;
+
+   if (!buf)
+      return NULL;
+   p += sprintf(p, "REM DATE 1991\nTITLE \"Loveless\"\n");
+   for (i = 1; i <= NTRACK; i++) {
+      frame = (i - 1) % 20 * 4500;
+      if (1 == i % 20)
+         p += sprintf(p, "FILE \"disc%d.wav\" WAVE\n", i / 20);
+      p += sprintf(p, "  TRACK %02d AUDIO\n", i);
+      p += sprintf(p, "    TITLE \"Track %d\"\n", i);
+      if (!(i % 3) && frame)
+         p += sprintf(p, "    INDEX 00 %02ld:%02ld:%02ld\n", (frame - 150) / 4500, (frame - 150) / 75 % 60, (frame - 150) % 75);
+      p += sprintf(p, "    INDEX 01 %02ld:%02ld:%02ld\n", frame / 4500, frame / 75 % 60, frame % 75);
+   }
+   return buf;
+}
+
+/* the disc of the document is the one of its text parsed in one piece */
+static char* compare(struct Document *doc)
+{
+   struct Parser *parser = parser_init();
+   struct Cd *a = document_get_cd(doc), *b;
+   struct Track *s, *t;
+   const char *text;
+   size_t len;
+   int i, j;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, PARSE_EXTENDED | PARSE_ENCODING);
+   text = document_get_text(doc, &len);
+   b = parser_cue_buffer(parser, text, len);
+   parser_free(parser);
+   mu_assert("only one parsed", !a == !b);
+   if (!a)
+      return NULL;
+   mu_assert("invalid number of tracks", cd_get_ntrack(a) == cd_get_ntrack(b));
+   mu_assert("different title", eq(cdtext_get(cd_get_cdtext(a), PTI_TITLE), cdtext_get(cd_get_cdtext(b), PTI_TITLE)));
+   mu_assert("different date", eq(rem_get(cd_get_cdtext(a), REM_DATE), rem_get(cd_get_cdtext(b), REM_DATE)));
+   for (i = 1; i <= cd_get_ntrack(a); i++) {
+      s = cd_get_track(a, i);
+      t = cd_get_track(b, i);
+      mu_assert("different filename", eq(track_get_filename(s), track_get_filename(t)));
+      mu_assert("different start", track_get_start(s) == track_get_start(t));
+      mu_assert("different length", track_get_length(s) == track_get_length(t));
+      mu_assert("different pregap", track_get_zero_pre(s) == track_get_zero_pre(t));
+      mu_assert("different track title", eq(cdtext_get(track_get_cdtext(s), PTI_TITLE), cdtext_get(track_get_cdtext(t), PTI_TITLE)));
+      for (j = 0; j < 3; j++)
+         mu_assert("different index", track_get_index(s, j) == track_get_index(t, j));
+   }
+   cd_free(b);
+   return NULL;
+}
+
+/* replace the first old after the line of track, return the bytes scanned */
+static long edit(struct Document *doc, int track, const char *old, const char *new)
+{
+   char line[32];
+   const char *text, *p;
+   struct Stats stats;
+   size_t len;
+
+   text = document_get_text(doc, &len);
+   sprintf(line, "TRACK %02d", track);
+   if (!(p = strstr(text, line)) || !(p = strstr(p, old)))
+      return -1;
+   cue_stats_reset();
+   if (document_edit(doc, p - text, strlen(old), new, strlen(new)))
+      return -1;
+   cue_stats_get(&stats);
+   return stats.bytes;
+}
+
+static char* edit_test()
+{
+   struct Parser *parser = parser_init();
+   struct Document *doc;
+   struct Track *track;
+   struct Cd *cd;
+   char *cue = make_cue(), *message;
+   const char *val;
+   long len;
+
+   mu_assert("error creating parser", parser != NULL && cue != NULL);
+   doc = parser_cue_document(parser, cue, strlen(cue));
+   parser_free(parser);
+   mu_assert("error creating document", doc != NULL && document_get_cd(doc) != NULL);
+   if ((message = compare(doc)))
+      return message;
+   cd = document_get_cd(doc);
+   track = cd_get_track(cd, 10);
+
+   /* a title, then the start of track 50 and with it the length of 49 */
+   len = edit(doc, 50, "Track 50", "Tracking");
+   mu_assert("error editing title", len > 0 && len < 200);
+   val = cdtext_get(track_get_cdtext(cd_get_track(cd, 50)), PTI_TITLE);
+   mu_assert("error validating title", val && !strcmp(val, "Tracking"));
+   len = edit(doc, 50, "INDEX 01 09:00:00", "INDEX 01 09:30:00");
+   mu_assert("error editing index", len > 0 && len < 200);
+   mu_assert("invalid length of track 49", track_get_length(cd_get_track(cd, 49)) == 4500 + 2250);
+   if ((message = compare(doc)))
+      return message;
+
+   /* the file of track 30 on to the next FILE line */
+   len = edit(doc, 29, "INDEX 01 08:00:00\n", "INDEX 01 08:00:00\nFILE \"new.wav\" WAVE\n");
+   mu_assert("error adding file", len > 0 && len < 200);
+   val = track_get_filename(cd_get_track(cd, 35));
+   mu_assert("file not carried", val && !strcmp(val, "new.wav"));
+   mu_assert("invalid length of track 29", track_get_length(cd_get_track(cd, 29)) == -1);
+   if ((message = compare(doc)))
+      return message;
+
+   /* the global statements */
+   len = edit(doc, 1, "", "");
+   mu_assert("error editing nothing", len > 0);
+   mu_assert("disc replaced", document_get_cd(doc) == cd && cd_get_track(cd, 10) == track);
+   if ((message = compare(doc)))
+      return message;
+
+   document_free(doc);
+   free(cue);
+   return NULL;
+}
+
+static char* structure_test()
+{
+   struct Parser *parser = parser_init();
+   struct Document *doc;
+   const char *text, *val;
+   char *cue = make_cue(), *message;
+   size_t len;
+
+   mu_assert("error creating parser", parser != NULL && cue != NULL);
+   parser_set_flag(parser, PARSE_EXTENDED);
+   doc = parser_cue_document(parser, cue, strlen(cue));
+   parser_free(parser);
+   mu_assert("error creating document", doc != NULL);
+
+   /* a new track in one piece */
+   mu_assert("error adding track", edit(doc, 40, "    INDEX 01", "  TRACK 41 AUDIO\n    INDEX 01") > 0);
+   mu_assert("track not added", cd_get_ntrack(document_get_cd(doc)) == NTRACK + 1);
+   if ((message = compare(doc)))
+      return message;
+
+   /* typed a word at a time, with errors on the way, in track 61 now */
+   mu_assert("error typing", edit(doc, 60, "    INDEX 01", "    PERF\n    INDEX 01") > 0);
+   if ((message = compare(doc)))
+      return message;
+   mu_assert("error typing", edit(doc, 60, "PERF\n", "PERFORMER\n") > 0);
+   mu_assert("error typing", edit(doc, 60, "PERFORMER\n", "PERFORMER \"Shields\"\n") > 0);
+   val = cdtext_get(track_get_cdtext(cd_get_track(document_get_cd(doc), 61)), PTI_PERFORMER);
+   mu_assert("error validating performer", val && !strcmp(val, "Shields"));
+   if ((message = compare(doc)))
+      return message;
+
+   /* nothing left to parse */
+   text = document_get_text(doc, &len);
+   mu_assert("error deleting", document_edit(doc, 0, len, "", 0) == -1 && !document_get_cd(doc));
+   mu_assert("out of range", document_edit(doc, 1, 0, "x", 1) == -1);
+   mu_assert("error inserting", !document_edit(doc, 0, 0, cue, strlen(cue)) && document_get_cd(doc));
+   text = document_get_text(doc, &len);
+   mu_assert("invalid text", len == strlen(cue) && !strcmp(text, cue));
+
+   document_free(doc);
+   free(cue);
+   return NULL;
+}
+
+/* a track parsed again reads its strings in the code page of all the text */
+static char* encoding_test()
+{
+   struct Parser *parser = parser_init();
+   struct Document *doc;
+   char *cue = make_cue(), *message, *p;
+
+   mu_assert("error creating parser", parser != NULL && cue != NULL);
+   mu_assert("no title of track 1", (p = strstr(cue, "Track 1\"")) != NULL);
+   p[2] = '\xE9';
+   parser_set_flag(parser, PARSE_ENCODING);
+   doc = parser_cue_document(parser, cue, strlen(cue));
+   parser_free(parser);
+   mu_assert("error creating document", doc != NULL && document_get_cd(doc) != NULL);
+   mu_assert("error editing title", edit(doc, 90, "Track 90", "Caf\xC3\xA9") > 0);
+   if ((message = compare(doc)))
+      return message;
+
+   document_free(doc);
+   free(cue);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   cue_stats_enable(1);
+   mu_run_test (edit_test);
+   mu_run_test (structure_test);
+   mu_run_test (encoding_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* the title quoted, its first word unquoted */
+#define SHEET(title, word)	"FILE \"a.wav\" WAVE\n"	\
+				"TITLE \"" title "\"\n"	\
+				"TRACK 01 AUDIO\n"		\
+				"PERFORMER " word "\n"		\
+				"INDEX 01 00:00:00\n"
+
+static struct Cd *parse(const char *buf, size_t len, int flags, enum Encoding *encoding)
+{
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+
+   if (!parser)
+      return NULL;
+   parser_set_flag(parser, PARSE_FAST_LEX | flags);
+   cd = parser_cue_buffer(parser, buf, len);
+   *encoding = parser_get_encoding(parser);
+   parser_free(parser);
+   return cd;
+}
+
+static char* check(const char *sheet, size_t len, int flags, enum Encoding encoding, const char *title)
+{
+   enum Encoding found;
+   struct Cd *cd = parse(sheet, len, flags, &found);
+   const char *val;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid encoding", found == encoding);
+   val = cdtext_get(cd_get_cdtext(cd), PTI_TITLE);
+   mu_assert("error validating title", val && !strcmp(val, title));
+   val = cdtext_get(track_get_cdtext(cd_get_track(cd, 1)), PTI_PERFORMER);
+   mu_assert("error validating performer", val && !strncmp(val, title, strlen(val)) && strchr(" ", title[strlen(val)]));
+   val = track_get_filename(cd_get_track(cd, 1));
+   mu_assert("error validating filename", val && !strcmp(val, "a.wav"));
+   cd_free(cd);
+   return NULL;
+}
+
+/* ASCII and UTF-8 stay as they are */
+static char* utf8_test()
+{
+   static const char ascii[] = SHEET("Loveless", "Loveless"),
+                     utf8[] = SHEET("Bj\xC3\xB6rk \xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88", "Bj\xC3\xB6rk");
+   char *message;
+
+   if ((message = check(ascii, strlen(ascii), PARSE_ENCODING, ENCODING_ASCII, "Loveless")))
+      return message;
+   if ((message = check(utf8, strlen(utf8), PARSE_ENCODING, ENCODING_UTF8, "Bj\xC3\xB6rk \xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88")))
+      return message;
+   return check(utf8, strlen(utf8), PARSE_LAZY_TEXT | PARSE_ENCODING, ENCODING_UTF8, "Bj\xC3\xB6rk \xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88");
+}
+
+/* UTF-8 as UTF-16 with a byte order mark, characters below U+10000 only */
+static char *utf16(const char *s, int be, size_t *len)
+{
+   char *buf = malloc(2 * strlen(s) + 2), *p = buf;
+   const unsigned char *q = (const unsigned char *)s;
+   unsigned c;
+
+   if (!buf)
+      return NULL;
+   for (c = 0xFEFF; ; ) {
+      *p++ = be ? c >> 8 : c & 0xFF;
+      *p++ = be ? c & 0xFF : c >> 8;
+      if (!*q)
+         break;
+      if (*q < 0x80)
+         c = *q++;
+      else if (*q < 0xE0) {
+         c = (q[0] & 0x1F) << 6 | (q[1] & 0x3F);
+         q += 2;
+      } else {
+         c = (q[0] & 0x0F) << 12 | (q[1] & 0x3F) << 6 | (q[2] & 0x3F);
+         q += 3;
+      }
+   }
+   *len = p - buf;
+   return buf;
+}
+
+static char* utf16_test()
+{
+   static const char sheet[] = SHEET("Bj\xC3\xB6rk \xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88", "Bj\xC3\xB6rk");
+   char *buf, *message;
+   size_t len;
+   int be;
+
+   for (be = 0; be < 2; be++) {
+      buf = utf16(sheet, be, &len);
+      mu_assert("error creating UTF-16", buf != NULL);
+      message = check(buf, len, PARSE_ENCODING | PARSE_LAZY_TEXT, be ? ENCODING_UTF16BE : ENCODING_UTF16LE,
+                      "Bj\xC3\xB6rk \xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88");
+      free(buf);
+      if (message)
+         return message;
+   }
+   return NULL;
+}
+
+/* code pages of Windows rippers */
+static char* legacy_test()
+{
+   static const char cp1252[] = SHEET("Bj\xF6rk - Hom\xE9genic", "Bj\xF6rk"),
+                     cp1251[] = SHEET("\xCA\xE8\xED\xEE - \xC3\xF0\xF3\xEF\xEF\xE0 \xEA\xF0\xEE\xE2\xE8", "\xCA\xE8\xED\xEE"),
+                     sjis[] = SHEET("\x83\x65\x83\x58\x83\x67 \xB1\xB2", "\x83\x65\x83\x58\x83\x67");
+   enum Encoding found;
+   struct Cd *cd;
+   char *message;
+
+   if ((message = check(cp1252, strlen(cp1252), PARSE_ENCODING, ENCODING_CP1252, "Bj\xC3\xB6rk - Hom\xC3\xA9genic")))
+      return message;
+   if ((message = check(cp1251, strlen(cp1251), PARSE_ENCODING, ENCODING_CP1251,
+                        "\xD0\x9A\xD0\xB8\xD0\xBD\xD0\xBE - \xD0\x93\xD1\x80\xD1\x83\xD0\xBF\xD0\xBF\xD0\xB0 "
+                        "\xD0\xBA\xD1\x80\xD0\xBE\xD0\xB2\xD0\xB8")))
+      return message;
+   if ((message = check(sjis, strlen(sjis), PARSE_ENCODING, ENCODING_SHIFT_JIS,
+                        "\xE3\x83\x86\xE3\x82\xB9\xE3\x83\x88 \xEF\xBD\xB1\xEF\xBD\xB2")))
+      return message;
+
+   /* as they are without the flag */
+   cd = parse(cp1252, strlen(cp1252), 0, &found);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("title converted", !strcmp(cdtext_get(cd_get_cdtext(cd), PTI_TITLE), "Bj\xF6rk - Hom\xE9genic"));
+   cd_free(cd);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (utf8_test);
+   mu_run_test (utf16_test);
+   mu_run_test (legacy_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+struct Summary {
+   char title[64];
+   int ntrack,
+       nindex,
+       stop;	/* stop after this track */
+   long index1[100];
+};
+
+static int on_track(void *data, int number, enum TrackMode mode, enum TrackSubMode sub_mode)
+{
+   struct Summary *s = data;
+
+   s->ntrack++;
+   return s->ntrack == s->stop ? 2 : 0;
+}
+
+static int on_index(void *data, int i, long index)
+{
+   struct Summary *s = data;
+
+   if (i == 1 && s->ntrack < 100)
+      s->index1[s->ntrack] = index;
+   s->nindex++;
+   return 0;
+}
+
+static int on_cdtext(void *data, enum Pti pti, const char *value)
+{
+   struct Summary *s = data;
+
+   if (!s->ntrack && pti == PTI_TITLE)
+      snprintf(s->title, sizeof(s->title), "%s", value);
+   return 0;
+}
+
+static const struct ParseEvents events = {
+   .track = on_track,
+   .index = on_index,
+   .cdtext = on_cdtext
+};
+
+static char* cue_events_test()
+{
+   struct Parser *parser = parser_init();
+   struct Summary s = {.stop = -1};
+   int status;
+
+   mu_assert("error creating parser", parser != NULL);
+
+   FILE *fp = fopen("99_tracks.cue", "r");
+   assert(fp);
+   status = parser_cue_file_events(parser, fp, &events, &s);
+   fclose(fp);
+   mu_assert("error parsing CUE", status == 0);
+   mu_assert("invalid number of tracks", s.ntrack == 99);
+   mu_assert("invalid number of indexes", s.nindex == 99);
+   mu_assert("error validating CD title", !strcmp(s.title, "Broken"));
+   mu_assert("invalid index", s.index1[3] == MSF_TO_F(4,49,67));
+
+   parser_free(parser);
+   return NULL;
+}
+
+static char* stop_test()
+{
+   static char cue[] = "FILE \"dummy.wav\" WAVE\n"
+                       "TRACK 01 AUDIO\n"
+                       "INDEX 01 00:00:00\n"
+                       "TRACK 02 AUDIO\n"
+                       "INDEX 01 01:00:00\n"
+                       "TRACK 03 AUDIO\n"
+                       "INDEX 01 02:00:00\n";
+   struct Parser *parser = parser_init();
+   struct Summary s = {.stop = 2};
+   int status;
+
+   mu_assert("error creating parser", parser != NULL);
+   status = parser_cue_buffer_events(parser, cue, strlen(cue), &events, &s);
+   mu_assert("parse not stopped", status == 2);
+   mu_assert("invalid number of tracks", s.ntrack == 2);
+   mu_assert("invalid number of indexes", s.nindex == 1);
+
+   /* the context is still usable after a stopped parse */
+   struct Cd *cd = parser_cue_string(parser, cue);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 3);
+   cd_free(cd);
+
+   parser_free(parser);
+   return NULL;
+}
+
+static char* toc_events_test()
+{
+   static char toc[] = "CD_DA\n"
+                       "TRACK AUDIO\n"
+                       "FILE \"loveless.wav\" 0 04:17:52\n"
+                       "TRACK AUDIO\n"
+                       "FILE \"loveless.wav\" 04:17:52\n"
+                       "START 00:02:00\n";
+   struct Parser *parser = parser_init();
+   struct Summary s = {.stop = -1};
+   int status;
+
+   mu_assert("error creating parser", parser != NULL);
+   status = parser_toc_buffer_events(parser, toc, strlen(toc), &events, &s);
+   mu_assert("error parsing TOC", status == 0);
+   mu_assert("invalid number of tracks", s.ntrack == 2);
+   mu_assert("invalid number of indexes", s.nindex == 4);
+   mu_assert("invalid index", s.index1[2] == MSF_TO_F(0,2,0));
+
+   parser_free(parser);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (cue_events_test);
+   mu_run_test (stop_test);
+   mu_run_test (toc_events_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+#define NCHAPTER 1000	/* one minute each */
+
+static char *make_cue()
+{
+   char *buf = malloc(64 + NCHAPTER * 64), *p = buf;
+   int i;
+
+   if (!buf)
+      return NULL;
+   p += sprintf(p, "FILE \"audiobook.wav\" WAVE\n");
+   for (i = 1; i <= NCHAPTER; i++)
+      p += sprintf(p, "TRACK %02d AUDIO\nTITLE \"Chapter %d\"\nINDEX 01 %02d:00:00\n", i, i, i - 1);
+   return buf;
+}
+
+static char *make_toc()
+{
+   char *buf = malloc(64 + NCHAPTER * 64), *p = buf;
+   int i;
+
+   if (!buf)
+      return NULL;
+   p += sprintf(p, "CD_DA\n");
+   for (i = 1; i <= NCHAPTER; i++)
+      p += sprintf(p, "TRACK AUDIO\nFILE \"audiobook.wav\" %02d:00:00 01:00:00\n", i - 1);
+   return buf;
+}
+
+static char* check_cd(struct Cd *cd, int ntrack)
+{
+   struct Track *track;
+
+   mu_assert("error parsing", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == ntrack);
+   track = cd_get_track(cd, ntrack);
+   mu_assert("invalid start of last track", track_get_start(track) == MSF_TO_F(ntrack - 1,0,0));
+   mu_assert("error validating filename", !strcmp(track_get_filename(track), "audiobook.wav"));
+   track = cd_get_track(cd, 1);
+   mu_assert("invalid length of first track", track_get_length(track) == MSF_TO_F(1,0,0));
+   mu_assert("no track past the last", cd_get_track(cd, ntrack + 1) == NULL);
+   return NULL;
+}
+
+static char* cue_extended_test()
+{
+   struct Parser *parser = parser_init();
+   char *cue = make_cue(), *message;
+   struct Cd *cd;
+
+   mu_assert("error creating parser", parser != NULL && cue != NULL);
+   parser_set_flag(parser, PARSE_EXTENDED);
+   cd = parser_cue_string(parser, cue);
+   message = check_cd(cd, NCHAPTER);
+   if (!message) {
+      const char *val = cdtext_get(track_get_cdtext(cd_get_track(cd, NCHAPTER)), PTI_TITLE);
+      mu_assert("error validating title", val && !strcmp(val, "Chapter 1000"));
+   }
+   cd_free(cd);
+
+   /* and in an arena */
+   parser_set_flag(parser, PARSE_ARENA);
+   cd = parser_cue_string(parser, cue);
+   message = message ? message : check_cd(cd, NCHAPTER);
+   cd_free(cd);
+
+   parser_free(parser);
+   free(cue);
+   return message;
+}
+
+static char* toc_extended_test()
+{
+   struct Parser *parser = parser_init();
+   char *toc = make_toc(), *message;
+   struct Cd *cd;
+
+   mu_assert("error creating parser", parser != NULL && toc != NULL);
+   parser_set_flag(parser, PARSE_EXTENDED);
+   cd = parser_toc_string(parser, toc);
+   message = check_cd(cd, NCHAPTER);
+   cd_free(cd);
+
+   parser_free(parser);
+   free(toc);
+   return message;
+}
+
+/* Red Book limits without PARSE_EXTENDED */
+static char* strict_test()
+{
+   char *cue = make_cue();
+   struct Cd *cd;
+
+   mu_assert("error creating sheet", cue != NULL);
+   cd = cue_parse_string(cue);
+   free(cue);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 99);
+   cd_free(cd);
+
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (cue_extended_test);
+   mu_run_test (toc_extended_test);
+   mu_run_test (strict_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static char cue[] =   "REM DATE 1991\n"
+                      "REM DISCNUMBER 1\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE \"Loomer\"\n"
+                      "ISRC GBAAA9100001\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:52\n";
+
+/* the same disc: quotes, CRLF, comments, the order of REM lines and the file name */
+static char same[] =  "; ripped again\r\n"
+                      "REM DISCNUMBER 1\r\n"
+                      "REM DATE 1991\r\n"
+                      "PERFORMER 'My Bloody Valentine'\r\n"
+                      "TITLE Loveless\r\n"
+                      "FILE \"Loveless (1991).flac\" WAVE\r\n"
+                      "  TRACK 01 AUDIO\r\n"
+                      "    TITLE \"Only Shallow\"\r\n"
+                      "    INDEX 01 00:00:00\r\n"
+                      "  TRACK 02 AUDIO\r\n"
+                      "    TITLE Loomer\r\n"
+                      "    ISRC GBAAA9100001\r\n"
+                      "    INDEX 00 04:15:52\r\n"
+                      "    INDEX 01 04:17:52\r\n";
+
+static char retitled[] = "REM DATE 1991\n"
+                      "REM DISCNUMBER 1\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless (Remaster)\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE \"Loomer\"\n"
+                      "ISRC GBAAA9100001\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:52\n";
+
+static char retimed[] = "REM DATE 1991\n"
+                      "REM DISCNUMBER 1\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE \"Loomer\"\n"
+                      "ISRC GBAAA9100001\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:53\n";
+
+static int fingerprint(const char *sheet, int parse_flags, int flags, unsigned char *out)
+{
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+
+   if (!parser)
+      return -1;
+   parser_set_flag(parser, parse_flags);
+   cd = parser_cue_buffer(parser, sheet, strlen(sheet));
+   parser_free(parser);
+   if (!cd)
+      return -1;
+   cd_fingerprint(cd, flags, out);
+   cd_free(cd);
+   return 0;
+}
+
+static int equal(const char *a, const char *b, int flags)
+{
+   unsigned char x[16], y[16];
+
+   return !fingerprint(a, 0, flags, x) && !fingerprint(b, 0, flags, y) && !memcmp(x, y, 16);
+}
+
+static char* same_test()
+{
+   unsigned char x[16], y[16];
+
+   mu_assert("different fingerprints", equal(cue, same, FINGERPRINT_CDTEXT));
+   mu_assert("different fingerprints without CD-TEXT", equal(cue, same, 0));
+   mu_assert("file name not covered", !equal(cue, same, FINGERPRINT_FILENAMES | FINGERPRINT_CDTEXT));
+   mu_assert("different with itself", equal(cue, cue, FINGERPRINT_FILENAMES | FINGERPRINT_CDTEXT));
+
+   /* spans of the input count as the strings they stand for */
+   mu_assert("error parsing", !fingerprint(cue, 0, FINGERPRINT_CDTEXT, x));
+   mu_assert("error parsing", !fingerprint(cue, PARSE_FAST_LEX | PARSE_LAZY_TEXT, FINGERPRINT_CDTEXT, y));
+   mu_assert("spans differ", !memcmp(x, y, 16));
+   return NULL;
+}
+
+static char* different_test()
+{
+   mu_assert("CD-TEXT not covered", !equal(cue, retitled, FINGERPRINT_CDTEXT));
+   mu_assert("CD-TEXT covered", equal(cue, retitled, FINGERPRINT_FILENAMES));
+   mu_assert("index not covered", !equal(cue, retimed, 0));
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (same_test);
+   mu_run_test (different_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
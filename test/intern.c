@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* the performer is set twice on track 2, dropping one reference */
+static char cue[] =   "PERFORMER \"My Bloody Valentine\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "PERFORMER \"Kevin Shields\"\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "INDEX 01 04:17:52\n"
+                      "TRACK 03 AUDIO\n"
+                      "PERFORMER \"Kevin Shields\"\n"
+                      "INDEX 01 06:58:35\n";
+
+static char* shared_test(int flag)
+{
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+   int i;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, flag);
+   FILE *fp = fopen("99_tracks.cue", "r");
+   assert(fp);
+   cd = parser_cue_file(parser, fp);
+   fclose(fp);
+   mu_assert("error parsing CUE", cd != NULL);
+
+   const char *name = track_get_filename(cd_get_track(cd, 1));
+   mu_assert("error validating filename", name && !strcmp(name, "dummy.wav"));
+   for (i = 2; i <= cd_get_ntrack(cd); i++)
+      mu_assert("filename not shared", track_get_filename(cd_get_track(cd, i)) == name);
+   cd_free(cd);
+
+   cd = parser_cue_string(parser, cue);
+   mu_assert("error parsing CUE", cd != NULL);
+   const char *mbv = cdtext_get(cd_get_cdtext(cd), PTI_PERFORMER),
+              *ks = cdtext_get(track_get_cdtext(cd_get_track(cd, 3)), PTI_PERFORMER);
+   mu_assert("error validating performer", mbv && !strcmp(mbv, "My Bloody Valentine"));
+   mu_assert("error validating performer", ks && !strcmp(ks, "Kevin Shields"));
+   for (i = 1; i <= 2; i++)
+      mu_assert("performer not shared",
+                cdtext_get(track_get_cdtext(cd_get_track(cd, i)), PTI_PERFORMER) == mbv);
+   cd_free(cd);
+
+   parser_free(parser);
+   return NULL;
+}
+
+static char* heap_test()
+{
+   return shared_test(0);
+}
+
+static char* arena_test()
+{
+   return shared_test(PARSE_ARENA);
+}
+
+static char* run_tests()
+{
+   mu_run_test (heap_test);
+   mu_run_test (arena_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static char cue[] =   "REM DATE 1991\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE Loomer\n"
+                      "REM REPLAYGAIN_TRACK_PEAK 0.9\n"
+                      "INDEX 01 04:17:52\n";
+
+static int in_input(const char *p)
+{
+   return p >= cue && p < cue + sizeof(cue);
+}
+
+static int span_is(const char *p, size_t len, const char *s)
+{
+   return p && len == strlen(s) && !memcmp(p, s, len);
+}
+
+static char* lazy_test(int flags)
+{
+   struct Parser *parser = parser_init();
+   struct Cdtext *cdtext;
+   struct Cd *cd;
+   const char *p;
+   size_t len;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, PARSE_FAST_LEX | PARSE_LAZY_TEXT | flags);
+   cd = parser_cue_buffer(parser, cue, strlen(cue));
+   parser_free(parser);
+   mu_assert("error parsing CUE", cd != NULL);
+
+   /* spans point into the input until a value is asked for */
+   cdtext = cd_get_cdtext(cd);
+   p = cdtext_get_span(cdtext, PTI_PERFORMER, &len);
+   mu_assert("performer not a span", in_input(p) && span_is(p, len, "My Bloody Valentine"));
+   p = rem_get_span(cdtext, REM_DATE, &len);
+   mu_assert("date not a span", in_input(p) && span_is(p, len, "1991"));
+   mu_assert("unset span", !cdtext_get_span(cdtext, PTI_GENRE, &len) && !len);
+
+   p = cdtext_get(cdtext, PTI_TITLE);
+   mu_assert("error validating title", p && !strcmp(p, "Loveless") && !in_input(p));
+   p = cdtext_get_span(cdtext, PTI_TITLE, &len);
+   mu_assert("title span not the copy", span_is(p, len, "Loveless") && !in_input(p));
+   p = cdtext_get_span(cdtext, PTI_PERFORMER, &len);
+   mu_assert("performer copied", in_input(p));
+
+   cdtext = track_get_cdtext(cd_get_track(cd, 2));
+   p = cdtext_get_span(cdtext, PTI_TITLE, &len);
+   mu_assert("unquoted title not a span", in_input(p) && span_is(p, len, "Loomer"));
+   p = rem_get(cdtext, REM_REPLAYGAIN_TRACK_PEAK);
+   mu_assert("error validating track peak", p && !strcmp(p, "0.9"));
+   p = cdtext_get(track_get_cdtext(cd_get_track(cd, 1)), PTI_TITLE);
+   mu_assert("error validating track title", p && !strcmp(p, "Only Shallow"));
+
+   cd_free(cd);
+   return NULL;
+}
+
+static char* heap_test()
+{
+   return lazy_test(0);
+}
+
+static char* arena_test()
+{
+   return lazy_test(PARSE_ARENA);
+}
+
+/* without the flag, or with flex, spans are the copies */
+static char* copy_test()
+{
+   struct Cd *cd = cue_parse_string(cue);
+   const char *p;
+   size_t len;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   p = cdtext_get_span(cd_get_cdtext(cd), PTI_PERFORMER, &len);
+   mu_assert("performer not copied", span_is(p, len, "My Bloody Valentine") && !in_input(p));
+   cd_free(cd);
+   return NULL;
+}
+
+/* values of a file outlive its mapping */
+static char* file_test()
+{
+   struct Parser *parser = parser_init();
+   char name[] = "lazyXXXXXX";
+   enum Format format = CUE;
+   struct Cd *cd;
+   const char *p;
+   size_t len;
+   int fd = mkstemp(name);
+
+   mu_assert("error creating parser", parser != NULL);
+   mu_assert("error writing file", fd >= 0 && write(fd, cue, strlen(cue)) == (ssize_t)strlen(cue) && !close(fd));
+   parser_set_flag(parser, PARSE_FAST_LEX | PARSE_LAZY_TEXT);
+   cd = parser_cf_parse(parser, name, &format);
+   parser_free(parser);
+   unlink(name);
+   mu_assert("error parsing CUE", cd != NULL);
+
+   p = cdtext_get_span(cd_get_cdtext(cd), PTI_PERFORMER, &len);
+   mu_assert("error validating performer", span_is(p, len, "My Bloody Valentine"));
+   p = cdtext_get(cd_get_cdtext(cd), PTI_TITLE);
+   mu_assert("error validating title", p && !strcmp(p, "Loveless"));
+   p = cdtext_get(track_get_cdtext(cd_get_track(cd, 2)), PTI_TITLE);
+   mu_assert("error validating track title", p && !strcmp(p, "Loomer"));
+   p = rem_get(track_get_cdtext(cd_get_track(cd, 2)), REM_REPLAYGAIN_TRACK_PEAK);
+   mu_assert("error validating track peak", p && !strcmp(p, "0.9"));
+   cd_free(cd);
+   return NULL;
+}
+
+/* spans save the allocation of every value */
+static char* alloc_test()
+{
+   struct Parser *parser = parser_init();
+   struct Stats copy, lazy;
+
+   mu_assert("error creating parser", parser != NULL);
+   cue_stats_enable(1);
+   parser_set_flag(parser, PARSE_FAST_LEX);
+   cue_stats_reset();
+   cd_free(parser_cue_buffer(parser, cue, strlen(cue)));
+   cue_stats_get(&copy);
+
+   parser_set_flag(parser, PARSE_LAZY_TEXT);
+   cue_stats_reset();
+   cd_free(parser_cue_buffer(parser, cue, strlen(cue)));
+   cue_stats_get(&lazy);
+   cue_stats_enable(0);
+   parser_free(parser);
+
+   /* 6 values, all different */
+   mu_assert("values allocated", lazy.allocs + 6 == copy.allocs);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (heap_test);
+   mu_run_test (arena_test);
+   mu_run_test (copy_test);
+   mu_run_test (file_test);
+   mu_run_test (alloc_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
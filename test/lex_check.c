@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* comments, blank lines, REM and the longest match corner cases of cue_scan.l */
+static char cue[] =   "\xEF\xBB\xBFREM GENRE \"Shoegaze\"\n"
+                      "; comment line\n"
+                      "REM DATE 1991\n"
+                      "REM REPLAYGAIN_ALBUM_GAIN -3.21 dB\n"
+                      "REM COMMENT \"ignored\"\n"
+                      "   \t\n"
+                      "PERFORMER My_Bloody_Valentine\n"
+                      "TITLE \"Loveless \\\"remastered\\\"\"\n"
+                      "FILE 'loveless.wav' WAVE ; trailing comment\n"
+                      "  TRACK 01 AUDIO\n"
+                      "    FLAGS DCP 4CH PRE\n"
+                      "    ISRC GBAAA9100001\n"
+                      "    TITLE \"Only Shallow\"\n"
+                      "    INDEX 01 00:00:00\n"
+                      "\n"
+                      "  TRACK 02 AUDIO\n"
+                      "    TITLE ISRC\n"
+                      "    PERFORMER \"a\"b\n"
+                      "    INDEX 01 04:17:52\n";
+
+static char* check_cd(struct Cd *cd)
+{
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+
+   struct Cdtext *cdtext = cd_get_cdtext(cd);
+   const char *val = cdtext_get(cdtext, PTI_TITLE);
+   mu_assert("error validating CD title", val && !strcmp(val, "Loveless \\\"remastered\\\""));
+   val = cdtext_get(cdtext, PTI_PERFORMER);
+   mu_assert("error validating CD performer", val && !strcmp(val, "My_Bloody_Valentine"));
+   val = cdtext_get(cdtext, PTI_GENRE);
+   mu_assert("error validating CD genre", val && !strcmp(val, "Shoegaze"));
+   val = rem_get(cdtext, REM_REPLAYGAIN_ALBUM_GAIN);
+   mu_assert("error validating album gain", val && !strcmp(val, "-3.21"));
+
+   struct Track *track = cd_get_track(cd, 1);
+   val = track_get_isrc(track);
+   mu_assert("error validating ISRC", val && !strcmp(val, "GBAAA9100001"));
+
+   track = cd_get_track(cd, 2);
+   val = cdtext_get(track_get_cdtext(track), PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "ISRC"));
+   val = cdtext_get(track_get_cdtext(track), PTI_PERFORMER);
+   mu_assert("error validating track performer", val && !strcmp(val, "\"a\"b"));
+   mu_assert("invalid track start", track_get_start(track) == (4 * 60 + 17) * 75 + 52);
+
+   cd_free(cd);
+   return NULL;
+}
+
+static char* parse_test(int flag)
+{
+   struct Parser *parser = parser_init();
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, flag);
+
+   char *message = check_cd(parser_cue_string(parser, cue));
+   parser_free(parser);
+
+   return message;
+}
+
+static char* string_test()
+{
+   char *message = parse_test(PARSE_LEX_CHECK);
+   return message ? message : parse_test(PARSE_FAST_LEX);
+}
+
+/* both scanners must return the same tokens for whole files */
+static char* file_test()
+{
+   static char buf[65536];
+   const char *names[] = {"99_tracks.cue", "issue10.cue"};
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+   size_t i, len;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, PARSE_LEX_CHECK);
+   for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+      FILE *fp = fopen(names[i], "r");
+      assert(fp);
+      len = fread(buf, 1, sizeof(buf), fp);
+      fclose(fp);
+
+      cd = parser_cue_buffer(parser, buf, len);
+      mu_assert("scanners disagree", cd != NULL);
+      cd_free(cd);
+   }
+   parser_free(parser);
+
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (string_test);
+   mu_run_test (file_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
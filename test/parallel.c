@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+#define NTRACK	6000	/* a chapter list in several chunks */
+#define NTHREAD	4
+
+static int eq(const char *a, const char *b)
+{
+   return a == b || (a && b && !strcmp(a, b));
+}
+
+/* no quotes, tracks of ten seconds, a new file every 100 tracks, index 00 on every third */
+static char *make_cue(const char *title2, const char *title_late, const char *bad)
+{
+   char *buf = malloc(256 + NTRACK * 128), *p = buf;
+   long frame;
+   int i;
+
+   if (!buf)
+      return NULL;
+   p += sprintf(p, "REM DATE 2001\nTITLE Audiobook\n");
+   for (i = 1; i <= NTRACK; i++) {
+      frame = (i - 1) % 100 * 750;
+      if (1 == i % 100)
+         p += sprintf(p, "FILE part%d.wav WAVE\n", i / 100);
+      p += sprintf(p, "  TRACK %02d AUDIO\n", i);
+      if (2 == i && title2)
+         p += sprintf(p, "    TITLE %s\n", title2);
+      else if (NTRACK * 3 / 4 == i && title_late)
+         p += sprintf(p, "    TITLE %s\n", title_late);
+      else
+         p += sprintf(p, "    TITLE Chapter_%d\n", i);
+      if (NTRACK - 10 == i && bad)
+         p += sprintf(p, "%s\n", bad);
+      if (!(i % 7))
+         p += sprintf(p, "    FLAGS DCP\n");
+      if (!(i % 3) && frame)
+         p += sprintf(p, "    INDEX 00 %02ld:%02ld:%02ld\n", (frame - 75) / 4500, (frame - 75) / 75 % 60, (frame - 75) % 75);
+      p += sprintf(p, "    INDEX 01 %02ld:%02ld:%02ld\n", frame / 4500, frame / 75 % 60, frame % 75);
+   }
+   return buf;
+}
+
+static struct Cd *parse(const char *cue, int flags, struct Stats *stats)
+{
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+
+   if (!parser)
+      return NULL;
+   parser_set_flag(parser, PARSE_FAST_LEX | PARSE_EXTENDED | flags);
+   parser_set_threads(parser, NTHREAD);
+   cue_stats_reset();
+   cd = parser_cue_string(parser, cue);
+   cue_stats_get(stats);
+   parser_free(parser);
+   return cd;
+}
+
+static char* compare(struct Cd *a, struct Cd *b)
+{
+   struct Track *s, *t;
+   int i, j;
+
+   mu_assert("only one parsed", !a == !b);
+   if (!a)
+      return NULL;
+   mu_assert("invalid number of tracks", cd_get_ntrack(a) == cd_get_ntrack(b));
+   mu_assert("different title", eq(cdtext_get(cd_get_cdtext(a), PTI_TITLE), cdtext_get(cd_get_cdtext(b), PTI_TITLE)));
+   mu_assert("different date", eq(rem_get(cd_get_cdtext(a), REM_DATE), rem_get(cd_get_cdtext(b), REM_DATE)));
+   for (i = 1; i <= cd_get_ntrack(a); i++) {
+      s = cd_get_track(a, i);
+      t = cd_get_track(b, i);
+      mu_assert("different filename", eq(track_get_filename(s), track_get_filename(t)));
+      mu_assert("different start", track_get_start(s) == track_get_start(t));
+      mu_assert("different length", track_get_length(s) == track_get_length(t));
+      mu_assert("different pregap", track_get_zero_pre(s) == track_get_zero_pre(t));
+      mu_assert("different track title", eq(cdtext_get(track_get_cdtext(s), PTI_TITLE), cdtext_get(track_get_cdtext(t), PTI_TITLE)));
+      for (j = 0; j < 3; j++)
+         mu_assert("different index", track_get_index(s, j) == track_get_index(t, j));
+   }
+   return NULL;
+}
+
+static char* check(char *cue, int flags, int parallel)
+{
+   struct Stats one, many;
+   struct Cd *a, *b;
+   char *message;
+
+   mu_assert("error creating CUE", cue != NULL);
+   a = parse(cue, flags, &one);
+   b = parse(cue, PARSE_PARALLEL | flags, &many);
+   message = compare(a, b);
+   cd_free(a);
+   cd_free(b);
+   /* parsed in parts or once more in one piece */
+   if (!message && parallel)
+      message = many.bytes == strlen(cue) ? NULL : "parsed again";
+   if (!message && !parallel)
+      message = many.bytes > strlen(cue) ? NULL : "not parsed in parts";
+   free(cue);
+   return message;
+}
+
+static char* parallel_test()
+{
+   char *cue = make_cue(NULL, NULL, NULL);
+   struct Stats stats;
+   struct Cd *cd;
+
+   mu_assert("error creating CUE", cue != NULL);
+   cd = parse(cue, PARSE_PARALLEL, &stats);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == NTRACK);
+   mu_assert("invalid length across files", track_get_length(cd_get_track(cd, 100)) == -1);
+   mu_assert("invalid length", track_get_length(cd_get_track(cd, NTRACK / 2 + 1)) == 750);
+   mu_assert("invalid statements", stats.statements > 3 * NTRACK);
+   cd_free(cd);
+   free(cue);
+   return check(make_cue(NULL, NULL, NULL), 0, 1);
+}
+
+/* a quoted string over many lines hides the TRACK lines in it */
+static char* quote_test()
+{
+   return check(make_cue("\"Contents", "Done\"", NULL), 0, 0);
+}
+
+static char* error_test()
+{
+   return check(make_cue(NULL, NULL, "    INDEX 01 AUDIO"), 0, 0);
+}
+
+/* a late chunk in UTF-8 is read in the code page of the whole sheet */
+static char* encoding_test()
+{
+   return check(make_cue("Caf\xE9", "Caf\xC3\xA9", NULL), PARSE_ENCODING, 1);
+}
+
+static char* run_tests()
+{
+   cue_stats_enable(1);
+   mu_run_test (parallel_test);
+   mu_run_test (quote_test);
+   mu_run_test (error_test);
+   mu_run_test (encoding_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+#define NFILE	400
+#define NTHREAD	4
+
+static char* parse_many_test()
+{
+   char *names[NFILE];
+   enum Format formats[NFILE];
+   enum CfError errors[NFILE];
+   struct Cd *cds[NFILE];
+   int i, nerror;
+
+   for (i = 0; i < NFILE; i++) {
+      formats[i] = UNKNOWN;
+      switch (i % 4) {
+      case 0:
+         names[i] = "99_tracks.cue";
+         break;
+      case 1:
+         names[i] = "issue10.cue";
+         break;
+      case 2:
+         names[i] = "missing.cue";
+         break;
+      case 3:
+         names[i] = "Makefile.am";
+         break;
+      }
+   }
+
+   nerror = cf_parse_many(names, formats, cds, errors, NFILE, NTHREAD);
+   mu_assert("invalid number of errors", nerror == NFILE / 2);
+
+   for (i = 0; i < NFILE; i++) {
+      switch (i % 4) {
+      case 0:
+         mu_assert("error parsing CUE", errors[i] == CF_OK && cds[i]);
+         mu_assert("invalid format", formats[i] == CUE);
+         mu_assert("invalid number of tracks", cd_get_ntrack(cds[i]) == 99);
+         break;
+      case 1:
+         mu_assert("error parsing CUE", errors[i] == CF_OK && cds[i]);
+         break;
+      case 2:
+         mu_assert("missing open error", errors[i] == CF_OPEN_ERROR && !cds[i]);
+         break;
+      case 3:
+         mu_assert("missing format error", errors[i] == CF_UNKNOWN_FORMAT && !cds[i]);
+         break;
+      }
+      cd_free(cds[i]);
+   }
+
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (parse_many_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
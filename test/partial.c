@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+static char cue[] =   "REM DATE 1991\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE \"Loomer\"\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:52\n"
+                      "TRACK 03 AUDIO\n"
+                      "TITLE \"Touched\"\n"
+                      "INDEX 01 07:00:00\n";
+
+static char toc[] =   "CD_DA\n"
+                      "CD_TEXT {\n"
+                      "  LANGUAGE_MAP { 0:9 }\n"
+                      "  LANGUAGE 0 {\n"
+                      "    TITLE \"Loveless\"\n"
+                      "  }\n"
+                      "}\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 0 04:17:52\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 04:17:52 02:42:23\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 07:00:00\n";
+
+static char* check_header(struct Cd *cd)
+{
+   const char *val;
+
+   mu_assert("error parsing", cd != NULL);
+   val = cdtext_get(cd_get_cdtext(cd), PTI_TITLE);
+   mu_assert("error validating CD title", val && !strcmp(val, "Loveless"));
+   return NULL;
+}
+
+static char* cue_test()
+{
+   struct Parser *parser = parser_init();
+   struct Stats stats;
+   struct Cd *cd;
+   char *message;
+   const char *val;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, PARSE_FAST_LEX);
+   cue_stats_enable(1);
+
+   /* global statements only */
+   parser_set_last_track(parser, 0);
+   cue_stats_reset();
+   cd = parser_cue_string(parser, cue);
+   cue_stats_get(&stats);
+   if ((message = check_header(cd)))
+      return message;
+   mu_assert("tracks parsed", cd_get_ntrack(cd) == 0);
+   val = rem_get(cd_get_cdtext(cd), REM_DATE);
+   mu_assert("error validating date", val && !strcmp(val, "1991"));
+   mu_assert("scanned past the header", stats.bytes <= (size_t)(strstr(cue, "TITLE \"Only") - cue));
+   cd_free(cd);
+
+   /* track 1 ends with the first index of track 2 */
+   parser_set_last_track(parser, 1);
+   cue_stats_reset();
+   cd = parser_cue_string(parser, cue);
+   cue_stats_get(&stats);
+   if ((message = check_header(cd)))
+      return message;
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 1);
+   mu_assert("invalid length of track 1", track_get_length(cd_get_track(cd, 1)) == MSF_TO_F(4,15,52));
+   mu_assert("scanned past track 2", stats.bytes <= (size_t)(strstr(cue, "INDEX 01 04") - cue));
+   cd_free(cd);
+
+   parser_set_last_track(parser, 2);
+   cd = parser_cue_string(parser, cue);
+   mu_assert("error parsing", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   val = cdtext_get(track_get_cdtext(cd_get_track(cd, 2)), PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "Loomer"));
+   mu_assert("invalid index 00", track_get_index(cd_get_track(cd, 2), 0) == MSF_TO_F(4,15,52));
+   mu_assert("invalid length of track 2", track_get_length(cd_get_track(cd, 2)) == MSF_TO_F(2,42,23));
+   cd_free(cd);
+
+   /* more than there are */
+   parser_set_last_track(parser, 99);
+   cd = parser_cue_string(parser, cue);
+   mu_assert("error parsing", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 3);
+   cd_free(cd);
+
+   cue_stats_enable(0);
+   parser_free(parser);
+   return NULL;
+}
+
+static char* toc_test()
+{
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+   char *message;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_last_track(parser, 0);
+   cd = parser_toc_string(parser, toc);
+   if ((message = check_header(cd)))
+      return message;
+   mu_assert("tracks parsed", cd_get_ntrack(cd) == 0);
+   cd_free(cd);
+
+   parser_set_last_track(parser, 2);
+   cd = parser_toc_string(parser, toc);
+   mu_assert("error parsing", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   mu_assert("invalid length of track 2", track_get_length(cd_get_track(cd, 2)) == MSF_TO_F(2,42,23));
+   cd_free(cd);
+
+   parser_set_last_track(parser, -1);
+   cd = parser_toc_string(parser, toc);
+   mu_assert("error parsing", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 3);
+   cd_free(cd);
+
+   parser_free(parser);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (cue_test);
+   mu_run_test (toc_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+#define NPARSE	1000	/* parses per context */
+#define NTHREAD	4
+
+static char cue[] =   "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"My Bloody Valentine - Loveless.wav\" WAVE\n"
+                        "TRACK 01 AUDIO\n"
+                           "TITLE \"Only Shallow\"\n"
+                           "INDEX 01 00:00:00\n"
+                        "TRACK 02 AUDIO\n"
+                           "TITLE \"Loomer\"\n"
+                           "INDEX 01 04:17:52\n";
+
+static char* check_string(struct Parser *parser)
+{
+   struct Cd *cd = parser_cue_string(parser, cue);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+
+   const char *val = cdtext_get(track_get_cdtext(cd_get_track(cd, 2)), PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "Loomer"));
+   mu_assert("invalid track length", track_get_length(cd_get_track(cd, 1)) == (4 * 60 + 17) * 75 + 52);
+   cd_free(cd);
+
+   return NULL;
+}
+
+static char* reuse_test()
+{
+   struct Parser *parser = parser_init();
+   mu_assert("error creating parser", parser != NULL);
+
+   int i;
+   for (i = 0; i < NPARSE; i++) {
+      FILE *fp = fopen("99_tracks.cue", "r");
+      assert(fp);
+      struct Cd *cd = parser_cue_file(parser, fp);
+      fclose(fp);
+      mu_assert("error parsing CUE file", cd != NULL);
+      mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 99);
+      cd_free(cd);
+
+      char *message = check_string(parser);
+      if (message)
+         return message;
+   }
+   parser_free(parser);
+
+   return NULL;
+}
+
+static void *thread_main(void *arg)
+{
+   struct Parser *parser = parser_init();
+   char *message = NULL;
+   int i;
+
+   for (i = 0; !message && i < NPARSE; i++)
+      message = check_string(parser);
+   parser_free(parser);
+
+   return message;
+}
+
+static char* thread_test()
+{
+   pthread_t thread[NTHREAD];
+   void *message;
+   int i;
+
+   for (i = 0; i < NTHREAD; i++)
+      assert(!pthread_create(&thread[i], NULL, thread_main, NULL));
+   for (i = 0; i < NTHREAD; i++) {
+      pthread_join(thread[i], &message);
+      if (message)
+         return message;
+   }
+
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (reuse_test);
+   mu_run_test (thread_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
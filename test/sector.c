@@ -0,0 +1,129 @@
+#include <stdio.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+/* data and audio in one bin file, frames of 2048 and 2352 bytes */
+static char mixed[] = "FILE \"game.bin\" BINARY\n"
+                      "TRACK 01 MODE1/2048\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "INDEX 00 10:00:00\n"
+                      "INDEX 01 10:02:00\n"
+                      "TRACK 03 AUDIO\n"
+                      "INDEX 01 13:00:00\n";
+
+static char files[] = "FILE \"a.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "INDEX 01 00:02:00\n"
+                      "FILE \"b.wav\" WAVE\n"
+                      "TRACK 03 AUDIO\n"
+                      "INDEX 01 00:00:00\n";
+
+static char toc[] =   "CD_DA\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"a.wav\" 0 02:00:00\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"a.wav\" 02:00:00 01:00:00\n"
+                      "START 00:02:00\n";
+
+static char* mixed_test()
+{
+   struct Cd *cd = cue_parse_string(mixed);
+   long long data = MSF_TO_F(10,0,0) * 2048LL, audio = MSF_TO_F(3,0,0) * 2352LL;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid block size", track_get_block_size(cd_get_track(cd, 1)) == 2048
+             && track_get_block_size(cd_get_track(cd, 2)) == 2352);
+
+   mu_assert("invalid offset of track 1", cd_get_track_offset(cd, 1) == 0);
+   mu_assert("invalid size of track 1", cd_get_track_size(cd, 1) == data);
+   mu_assert("sample offset of data", cd_get_track_sample(cd, 1) == -1);
+
+   /* the pregap in the file is part of track 2 */
+   mu_assert("invalid offset of track 2", cd_get_track_offset(cd, 2) == data);
+   mu_assert("invalid size of track 2", cd_get_track_size(cd, 2) == audio);
+   mu_assert("invalid sample offset of track 2", cd_get_track_sample(cd, 2) == data / 4);
+
+   mu_assert("invalid offset of track 3", cd_get_track_offset(cd, 3) == data + audio);
+   mu_assert("size of last track known", cd_get_track_size(cd, 3) == -1);
+   mu_assert("invalid sample offset of track 3", cd_get_track_sample(cd, 3) == (data + audio) / 4);
+
+   mu_assert("track out of range", cd_get_track_offset(cd, 0) == -1 && cd_get_track_size(cd, 4) == -1);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* files_test()
+{
+   struct Cd *cd = cue_parse_string(files);
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid size of track 1", cd_get_track_size(cd, 1) == MSF_TO_F(0,2,0) * 2352LL);
+   mu_assert("invalid sample offset of track 2", cd_get_track_sample(cd, 2) == MSF_TO_F(0,2,0) * 588LL);
+   mu_assert("size of last track in file known", cd_get_track_size(cd, 2) == -1);
+   mu_assert("invalid offset in the second file", cd_get_track_offset(cd, 3) == 0);
+   cd_free(cd);
+   return NULL;
+}
+
+/* TOC tracks are the part of the file they give, with START in it */
+static char* toc_test()
+{
+   struct Cd *cd = toc_parse_string(toc);
+
+   mu_assert("error parsing TOC", cd != NULL);
+   mu_assert("invalid offset of track 2", cd_get_track_offset(cd, 2) == MSF_TO_F(2,0,0) * 2352LL);
+   mu_assert("invalid size of track 2", cd_get_track_size(cd, 2) == MSF_TO_F(1,0,0) * 2352LL);
+   mu_assert("invalid sample offset of track 2", cd_get_track_sample(cd, 2) == MSF_TO_F(2,0,0) * 588LL);
+   cd_free(cd);
+   return NULL;
+}
+
+/* all tracks in one call, the same as one at a time */
+static char* ranges_test()
+{
+   struct Cd *cd = cue_parse_string(mixed);
+   long long offset[3], size[3], sample[3];
+   int i, nerror = 0;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("invalid number of tracks", cd_get_track_ranges(cd, offset, size, sample) == 3);
+   for (i = 1; i <= 3; i++)
+      nerror += offset[i - 1] != cd_get_track_offset(cd, i) || size[i - 1] != cd_get_track_size(cd, i)
+                || sample[i - 1] != cd_get_track_sample(cd, i);
+   mu_assert("ranges differ", !nerror);
+   mu_assert("error without arrays", cd_get_track_ranges(cd, NULL, size, NULL) == 3);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (mixed_test);
+   mu_run_test (files_test);
+   mu_run_test (toc_test);
+   mu_run_test (ranges_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
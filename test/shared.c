@@ -0,0 +1,198 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+#define NTHREAD	4
+#define NREAD	2000
+
+static char cue[] =   "REM DATE 1991\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "TITLE \"Only Shallow\"\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "TITLE \"Loomer\"\n"
+                      "ISRC GBAAA9100001\n"
+                      "INDEX 00 04:15:52\n"
+                      "INDEX 01 04:17:52\n"
+                      "TRACK 03 AUDIO\n"
+                      "TITLE \"Touched\"\n"
+                      "INDEX 01 07:00:00\n";
+
+static int in_input(const char *p)
+{
+   return p >= cue && p < cue + sizeof(cue);
+}
+
+static struct Cd *parse(int flags)
+{
+   struct Parser *parser = parser_init();
+   struct Cd *cd;
+
+   if (!parser)
+      return NULL;
+   parser_set_flag(parser, flags);
+   cd = parser_cue_buffer(parser, cue, strlen(cue));
+   parser_free(parser);
+   return cd;
+}
+
+static const char *title(struct Cd *cd, int i)
+{
+   return cdtext_get(i ? track_get_cdtext(cd_get_track(cd, i)) : cd_get_cdtext(cd), PTI_TITLE);
+}
+
+/* spans become strings, and setters leave the disc as it is */
+static char* freeze_test()
+{
+   struct Cd *cd = parse(PARSE_FAST_LEX | PARSE_LAZY_TEXT), *copy;
+   struct Track *track;
+   const char *p;
+   size_t len;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("disc frozen", !cd_is_frozen(cd));
+   mu_assert("error freezing", !cd_freeze(cd) && cd_is_frozen(cd));
+   p = cdtext_get_span(cd_get_cdtext(cd), PTI_PERFORMER, &len);
+   mu_assert("span kept", p && !in_input(p));
+
+   track = cd_get_track(cd, 2);
+   mu_assert("setter not refused", track_set_index(track, 1, 0) == -1 && track_set_filename(track, "other.wav") == -1
+             && cdtext_set(track_get_cdtext(track), PTI_TITLE, "Other") == -1);
+   mu_assert("index written", track_get_index(track, 1) == 19327);
+   mu_assert("filename written", !strcmp(track_get_filename(track), "loveless.wav"));
+   mu_assert("title written", !strcmp(title(cd, 2), "Loomer"));
+
+   /* the only owner gets the disc itself, if not frozen */
+   copy = cd_edit(cd);
+   mu_assert("copy of a frozen disc", copy != NULL && copy != cd);
+   cd_unref(copy);
+   cd = parse(0);
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("copy of an unshared disc", cd_edit(cd) == cd);
+   cd_unref(cd);
+   return NULL;
+}
+
+/* a copy borrows what it does not write */
+static char* edit_test()
+{
+   struct Cd *cd = parse(0), *copy;
+   struct Track *track;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   copy = cd_edit(cd_ref(cd));
+   mu_assert("error editing", copy != NULL && copy != cd);
+   mu_assert("disc not frozen", cd_is_frozen(cd) && !cd_is_frozen(copy));
+
+   track = cd_get_track(copy, 2);
+   mu_assert("error setting", !track_set_index(track, 1, 0)
+             && !cdtext_set(track_get_cdtext(cd_get_track(copy, 1)), PTI_TITLE, "Shallow")
+             && !cdtext_set(cd_get_cdtext(copy), PTI_TITLE, "Loveless (Remaster)"));
+   mu_assert("index not written", track_get_index(track, 1) == 0);
+   mu_assert("title not written", !strcmp(title(copy, 1), "Shallow") && !strcmp(title(copy, 0), "Loveless (Remaster)"));
+
+   /* the frozen disc is unchanged */
+   mu_assert("index changed", track_get_index(cd_get_track(cd, 2), 1) == 19327);
+   mu_assert("title changed", !strcmp(title(cd, 1), "Only Shallow") && !strcmp(title(cd, 0), "Loveless"));
+
+   /* only the written parts are copies */
+   mu_assert("written track borrowed", track_get_isrc(track) != track_get_isrc(cd_get_track(cd, 2)));
+   mu_assert("track CD-TEXT copied", title(copy, 2) == title(cd, 2));
+   mu_assert("track copied", track_get_filename(cd_get_track(copy, 3)) == track_get_filename(cd_get_track(cd, 3)));
+
+   /* the copy keeps what it borrows */
+   cd_unref(cd);
+   mu_assert("error reading copy", !strcmp(title(copy, 3), "Touched") && !strcmp(track_get_isrc(track), "GBAAA9100001"));
+   cd_unref(copy);
+   return NULL;
+}
+
+/* a shared disc is frozen, with no spans left to resolve */
+static char* ref_test()
+{
+   struct Cd *cd = parse(PARSE_FAST_LEX | PARSE_LAZY_TEXT);
+   const char *p;
+   size_t len;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   p = cdtext_get_span(track_get_cdtext(cd_get_track(cd, 1)), PTI_TITLE, &len);
+   mu_assert("no span", p && in_input(p));
+   mu_assert("error referencing", cd_ref(cd) == cd && cd_is_frozen(cd));
+   p = cdtext_get_span(track_get_cdtext(cd_get_track(cd, 1)), PTI_TITLE, &len);
+   mu_assert("span kept", p && !in_input(p) && len == 12);
+   mu_assert("setter not refused", cd_get_track(cd, 1) && track_set_isrc(cd_get_track(cd, 1), "GBAAA9100002") == -1);
+   cd_unref(cd);
+   cd_unref(cd);
+   return NULL;
+}
+
+static void *reader(void *arg)
+{
+   struct Cd *cd = arg;
+   long sum = 0;
+   int i, n;
+
+   for (n = 0; n < NREAD; n++)
+      for (i = 1; i <= cd_get_ntrack(cd); i++)
+         sum += track_get_index(cd_get_track(cd, i), 1) + strlen(title(cd, i));
+   cd_unref(cd);
+   return sum == NREAD * (19327 + 31500 + 12 + 6 + 7) ? NULL : arg;
+}
+
+/* readers of a shared disc while it is edited */
+static char* thread_test()
+{
+   struct Cd *cd = parse(PARSE_FAST_LEX | PARSE_LAZY_TEXT), *copy;
+   pthread_t thread[NTHREAD];
+   void *result;
+   int i, n, nerror = 0;
+
+   mu_assert("error parsing CUE", cd != NULL);
+   for (n = 0; n < NTHREAD; n++)
+      mu_assert("error creating thread", !pthread_create(&thread[n], NULL, reader, cd_ref(cd)));
+   for (i = 0; i < NREAD; i++) {
+      copy = cd_edit(cd_ref(cd));
+      mu_assert("error editing", copy != NULL);
+      nerror += track_set_index(cd_get_track(copy, 2), 1, i)
+                || cdtext_set(track_get_cdtext(cd_get_track(copy, 3)), PTI_TITLE, "Untouched");
+      nerror += track_get_index(cd_get_track(copy, 2), 1) != i || strcmp(title(copy, 3), "Untouched");
+      cd_unref(copy);
+   }
+   for (n = 0; n < NTHREAD; n++) {
+      pthread_join(thread[n], &result);
+      nerror += result != NULL;
+   }
+   cd_unref(cd);
+   mu_assert("error reading", !nerror);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (freeze_test);
+   mu_run_test (edit_test);
+   mu_run_test (ref_test);
+   mu_run_test (thread_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+static char cue[] =   "; ripped 2001\r\n"
+                      "REM DATE 1991\r\n"
+                      "REM COMMENT \"kept as it is\"\r\n"
+                      "PERFORMER \"My Bloody Valentine\"\r\n"
+                      "TITLE Loveless\r\n"
+                      "FILE \"01 Only Shallow.wav\" WAVE\r\n"
+                      "  TRACK 01 AUDIO\r\n"
+                      "    TITLE 'Only Shallow'\r\n"
+                      "    FLAGS DCP PRE\r\n"
+                      "    INDEX 01 00:00:00\r\n"
+                      "FILE loomer.wav WAVE\r\n"
+                      "  TRACK 02 AUDIO\r\n"
+                      "    TITLE   \"Loomer\"   \r\n"
+                      "    INDEX 00   00:00:00\r\n"
+                      "    INDEX 01   00:02:00\r\n";
+
+static char edited[] = "; ripped 2001\r\n"
+                      "REM DATE 1991\r\n"
+                      "REM COMMENT \"kept as it is\"\r\n"
+                      "PERFORMER \"My Bloody Valentine\"\r\n"
+                      "TITLE \"Loveless (Remaster)\"\r\n"
+                      "FILE \"01 Only Shallow.flac\" WAVE\r\n"
+                      "  TRACK 01 AUDIO\r\n"
+                      "    TITLE 'Only Shallow'\r\n"
+                      "    FLAGS DCP PRE\r\n"
+                      "    INDEX 01 00:00:00\r\n"
+                      "FILE loomer.flac WAVE\r\n"
+                      "  TRACK 02 AUDIO\r\n"
+                      "    TITLE   \"Loomer\"   \r\n"
+                      "    INDEX 00   00:00:00\r\n"
+                      "    INDEX 01   00:01:74\r\n";
+
+/* whatever is written to fp */
+static char *contents(FILE *fp)
+{
+   long len = ftell(fp);
+   char *buf = malloc(len + 1);
+
+   rewind(fp);
+   if (buf)
+      buf[fread(buf, 1, len, fp)] = '\0';
+   return buf;
+}
+
+static char* print_test()
+{
+   struct Parser *parser = parser_init();
+   struct Sheet *sheet;
+   FILE *fp = tmpfile();
+   char *out;
+
+   mu_assert("error creating parser", parser != NULL && fp != NULL);
+   sheet = parser_cue_sheet(parser, cue, strlen(cue));
+   parser_free(parser);
+   mu_assert("error parsing CUE", sheet != NULL);
+
+   mu_assert("error printing", !sheet_print(fp, sheet));
+   out = contents(fp);
+   mu_assert("not printed as it is", out && !strcmp(out, cue));
+   free(out);
+   fclose(fp);
+   sheet_free(sheet);
+   return NULL;
+}
+
+/* rename .wav to .flac and retime a track, nothing else changes */
+static char* edit_test()
+{
+   struct Parser *parser = parser_init();
+   struct Sheet *sheet;
+   struct Cd *cd;
+   FILE *fp = tmpfile();
+   char name[64], *out;
+   const char *p;
+   size_t len;
+   int i;
+
+   mu_assert("error creating parser", parser != NULL && fp != NULL);
+   sheet = parser_cue_sheet(parser, cue, strlen(cue));
+   mu_assert("error parsing CUE", sheet != NULL);
+   mu_assert("invalid number of files", sheet_get_nfile(sheet) == 2);
+   for (i = 0; i < sheet_get_nfile(sheet); i++) {
+      p = sheet_get_file(sheet, i, &len);
+      mu_assert("no file", p && len > 4 && len < sizeof(name));
+      sprintf(name, "%.*s.flac", (int)len - 4, p);
+      mu_assert("error renaming", !sheet_set_file(sheet, i, name));
+   }
+   p = sheet_get_file(sheet, 0, &len);
+   mu_assert("rename not visible", len == 20 && !memcmp(p, "01 Only Shallow.flac", len));
+   mu_assert("error setting title", !sheet_set_cdtext(sheet, 0, PTI_TITLE, "Loveless (Remaster)"));
+   mu_assert("error setting index", !sheet_set_index(sheet, 2, 1, MSF_TO_F(0,1,74)));
+
+   /* what can't be written */
+   mu_assert("no such statement", sheet_set_cdtext(sheet, 1, PTI_PERFORMER, "x") == -1);
+   mu_assert("no such index", sheet_set_index(sheet, 1, 0, 0) == -1);
+   mu_assert("no such file", sheet_set_file(sheet, 2, "x") == -1 && !sheet_get_file(sheet, 2, &len));
+   mu_assert("newline written", sheet_set_cdtext(sheet, 2, PTI_TITLE, "a\nb") == -1);
+   mu_assert("quote written", sheet_set_cdtext(sheet, 1, PTI_TITLE, "Don't") == -1);
+
+   mu_assert("error printing", !sheet_print(fp, sheet));
+   sheet_free(sheet);
+   out = contents(fp);
+   fclose(fp);
+   mu_assert("error validating edits", out && !strcmp(out, edited));
+
+   /* and it parses to the edited values */
+   cd = parser_cue_string(parser, out);
+   parser_free(parser);
+   free(out);
+   mu_assert("error parsing edited CUE", cd != NULL);
+   p = track_get_filename(cd_get_track(cd, 2));
+   mu_assert("error validating filename", p && !strcmp(p, "loomer.flac"));
+   mu_assert("error validating index", track_get_index(cd_get_track(cd, 2), 1) == MSF_TO_F(0,1,74));
+   p = cdtext_get(cd_get_cdtext(cd), PTI_TITLE);
+   mu_assert("error validating title", p && !strcmp(p, "Loveless (Remaster)"));
+   cd_free(cd);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (print_test);
+   mu_run_test (edit_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static char cue[] =   "REM DATE 1991\n"
+                      "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"loveless.wav\" WAVE\n"
+                      "  TRACK 01 AUDIO\n"
+                      "    INDEX 01 00:00:00\n"
+                      "  TRACK 02 AUDIO\n"
+                      "    INDEX 01 04:17:52\n";
+
+static char toc[] =   "CD_DA\n"
+                      "// ripped 2001\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 0 04:17:52\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"loveless.wav\" 04:17:52\n";
+
+/* both have TITLE, FILE and INDEX: no keyword of one format only */
+static char neither[] = "TITLE \"Loveless\"\n"
+                        "FILE \"loveless.wav\" WAVE\n";
+
+static char utf16[] = "\xFF\xFET\0R\0A\0C\0K\0 \0" "0\0" "1\0 \0A\0U\0D\0I\0O\0\n\0";
+
+/* a name with the suffix given, holding data */
+static char *temp_file(const char *suffix, const char *data, size_t len)
+{
+   char name[] = "sniffXXXXXX";
+   char *path;
+   FILE *fp;
+   int fd = mkstemp(name);
+
+   if (fd < 0)
+      return NULL;
+   close(fd);
+   unlink(name);
+   if (!(path = malloc(strlen(name) + strlen(suffix) + 1)))
+      return NULL;
+   sprintf(path, "%s%s", name, suffix);
+   if (!(fp = fopen(path, "wb")) || fwrite(data, 1, len, fp) != len || fclose(fp)) {
+      free(path);
+      return NULL;
+   }
+   return path;
+}
+
+static char* sniff_test()
+{
+   char binary[512];
+   size_t i;
+
+   mu_assert("CUE not recognized", cf_format_sniff(cue, strlen(cue)) == CUE);
+   mu_assert("TOC not recognized", cf_format_sniff(toc, strlen(toc)) == TOC);
+   mu_assert("format guessed", cf_format_sniff(neither, strlen(neither)) == UNKNOWN);
+   mu_assert("UTF-16 CUE not recognized", cf_format_sniff(utf16, sizeof(utf16) - 1) == CUE);
+
+   /* a CUE keyword in a stream of control bytes */
+   memcpy(binary, cue, strlen(cue));
+   for (i = strlen(cue); i < sizeof(binary); i++)
+      binary[i] = i % 31;
+   mu_assert("binary data recognized", cf_format_sniff(binary, sizeof(binary)) == UNKNOWN);
+   return NULL;
+}
+
+/* the content tells the format where the suffix does not */
+static char* suffix_test()
+{
+   char *name = temp_file(".txt", toc, strlen(toc));
+   enum Format format = UNKNOWN;
+   struct Cd *cd;
+
+   mu_assert("error writing file", name != NULL);
+   cd = cf_parse(name, &format);
+   remove(name);
+   free(name);
+   mu_assert("error parsing TOC", cd != NULL);
+   mu_assert("invalid format", format == TOC);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* reject_test()
+{
+   char *names[3], binary[256];
+   enum Format formats[3] = {UNKNOWN, UNKNOWN, CUE};
+   enum CfError errors[3];
+   struct Cd *cds[3];
+   struct Parser *parser = parser_init();
+   enum Format format = UNKNOWN;
+   size_t i;
+
+   mu_assert("error creating parser", parser != NULL);
+   for (i = 0; i < sizeof(binary); i++)
+      binary[i] = i;
+   names[0] = temp_file(".cue", binary, sizeof(binary));
+   names[1] = temp_file(".txt", neither, strlen(neither));
+   names[2] = temp_file(".dat", cue, strlen(cue));
+   mu_assert("error writing files", names[0] && names[1] && names[2]);
+
+   mu_assert("invalid number of errors", cf_parse_many(names, formats, cds, errors, 3, 1) == 2);
+   mu_assert("binary data parsed", errors[0] == CF_NOT_A_SHEET && !cds[0]);
+   mu_assert("missing format error", errors[1] == CF_UNKNOWN_FORMAT && !cds[1]);
+   mu_assert("error parsing CUE", errors[2] == CF_OK && cds[2]);
+   cd_free(cds[2]);
+
+   /* larger than allowed */
+   parser_set_max_size(parser, strlen(cue) - 1);
+   mu_assert("large file parsed", !parser_cf_parse(parser, names[2], &format));
+   parser_set_max_size(parser, strlen(cue));
+   cds[2] = parser_cf_parse(parser, names[2], &format);
+   mu_assert("error parsing CUE", cds[2] != NULL && format == CUE);
+   cd_free(cds[2]);
+   parser_free(parser);
+
+   for (i = 0; i < 3; i++) {
+      remove(names[i]);
+      free(names[i]);
+   }
+   return NULL;
+}
+
+/* UTF-16 is read with PARSE_ENCODING only, never given to the scanners as it is */
+static char* utf16_test()
+{
+   char wide[2 * sizeof(cue)], *name;
+   struct Parser *parser = parser_init();
+   enum Format format = UNKNOWN;
+   enum CfError error;
+   struct Cd *cd;
+   size_t i;
+
+   mu_assert("error creating parser", parser != NULL);
+   wide[0] = '\xFF';
+   wide[1] = '\xFE';
+   for (i = 0; i < strlen(cue); i++) {
+      wide[2 + 2 * i] = cue[i];
+      wide[3 + 2 * i] = '\0';
+   }
+   name = temp_file(".cue", wide, 2 + 2 * strlen(cue));
+   mu_assert("error writing file", name != NULL);
+
+   mu_assert("invalid number of errors", cf_parse_many(&name, &format, &cd, &error, 1, 1) == 1);
+   mu_assert("UTF-16 parsed without PARSE_ENCODING", error == CF_NOT_A_SHEET && !cd);
+   parser_set_flag(parser, PARSE_ENCODING);
+   cd = parser_cf_parse(parser, name, &format);
+   remove(name);
+   free(name);
+   parser_free(parser);
+   mu_assert("error parsing UTF-16 CUE", cd != NULL && format == CUE);
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (sniff_test);
+   mu_run_test (suffix_test);
+   mu_run_test (reject_test);
+   mu_run_test (utf16_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
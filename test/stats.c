@@ -0,0 +1,139 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+static char cue[] =   "PERFORMER \"My Bloody Valentine\"\n"
+                      "TITLE \"Loveless\"\n"
+                      "FILE \"My Bloody Valentine - Loveless.wav\" WAVE\n"
+                        "TRACK 01 AUDIO\n"
+                           "TITLE \"Only Shallow\"\n"
+                           "INDEX 01 00:00:00\n"
+                        "TRACK 02 AUDIO\n"
+                           "TITLE \"Loomer\"\n"
+                           "INDEX 01 04:17:52\n";
+
+/* TRACK without a number */
+static char bad[] =   "FILE \"loveless.wav\" WAVE\n"
+                      "TRACK AUDIO\n";
+
+static char* count_test(int flag)
+{
+   struct Parser *parser = parser_init();
+   struct Stats stats;
+   struct Cd *cd;
+
+   mu_assert("error creating parser", parser != NULL);
+   parser_set_flag(parser, flag);
+   cue_stats_reset();
+   cd = parser_cue_string(parser, cue);
+   mu_assert("error parsing CUE", cd != NULL);
+   cd_free(cd);
+   parser_free(parser);
+
+   cue_stats_get(&stats);
+   mu_assert("invalid number of bytes", stats.bytes == strlen(cue));
+   /* 10 header, 15 for each track (8 for INDEX 01 mm:ss:ff) and the end */
+   mu_assert("invalid number of tokens", stats.tokens == 10 + 2 * 15 + 1);
+   /* one event per statement */
+   mu_assert("invalid number of statements", stats.statements == 9);
+   mu_assert("no syntax error", stats.errors == 0);
+   mu_assert("no allocations", stats.allocs > 0 && stats.alloc_bytes > 0);
+   mu_assert("time printing", stats.print_usec == 0);
+   return NULL;
+}
+
+static char* flex_test()
+{
+   return count_test(0);
+}
+
+static char* fast_lex_test()
+{
+   return count_test(PARSE_FAST_LEX);
+}
+
+static char* error_test()
+{
+   struct Stats stats;
+
+   cue_stats_reset();
+   mu_assert("parsed bad CUE", cue_parse_string(bad) == NULL);
+   cue_stats_get(&stats);
+   mu_assert("invalid number of syntax errors", stats.errors == 1);
+
+   cue_stats_reset();
+   mu_assert("parsed bad TOC", toc_parse_string("CD_DA\nTRACK\n") == NULL);
+   cue_stats_get(&stats);
+   mu_assert("invalid number of TOC syntax errors", stats.errors == 1);
+
+   cue_stats_reset();
+   cue_stats_get(&stats);
+   mu_assert("not reset", !stats.bytes && !stats.tokens && !stats.errors && !stats.allocs);
+   return NULL;
+}
+
+static void *parse_thread(void *arg)
+{
+   struct Stats *stats = arg;
+
+   cd_free(cue_parse_string(cue));
+   cue_stats_get(stats);
+   return NULL;
+}
+
+/* a thread counts on its own */
+static char* thread_test()
+{
+   struct Stats stats, thread;
+   pthread_t tid;
+
+   cue_stats_reset();
+   mu_assert("error creating thread", !pthread_create(&tid, NULL, parse_thread, &thread));
+   pthread_join(tid, NULL);
+   cue_stats_get(&stats);
+   mu_assert("counted on the wrong thread", stats.tokens == 0);
+   mu_assert("not counted on the thread", thread.tokens > 0 && thread.bytes == strlen(cue));
+   return NULL;
+}
+
+static char* disabled_test()
+{
+   struct Stats stats;
+
+   cue_stats_enable(0);
+   cue_stats_reset();
+   cd_free(cue_parse_string(cue));
+   cue_stats_get(&stats);
+   cue_stats_enable(1);
+   mu_assert("counted while disabled", !stats.bytes && !stats.tokens && !stats.allocs);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   cue_stats_enable(1);
+   mu_run_test (flex_test);
+   mu_run_test (fast_lex_test);
+   mu_run_test (error_test);
+   mu_run_test (thread_test);
+   mu_run_test (disabled_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
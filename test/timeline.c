@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+#define NCHAPTER	3000
+
+/* one file with a pregap in it, one of zero data and a postgap */
+static char cue[] =   "FILE \"a.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "INDEX 00 01:00:00\n"
+                      "INDEX 01 01:02:00\n"
+                      "TRACK 03 AUDIO\n"
+                      "PREGAP 00:02:00\n"
+                      "INDEX 01 02:00:00\n"
+                      "POSTGAP 00:01:00\n"
+                      "TRACK 04 AUDIO\n"
+                      "INDEX 01 03:00:00\n"
+                      "INDEX 02 03:30:00\n";
+
+/* the pregap of track 2 at the end of the first file */
+static char files[] = "FILE \"a.wav\" WAVE\n"
+                      "TRACK 01 AUDIO\n"
+                      "INDEX 01 00:00:00\n"
+                      "TRACK 02 AUDIO\n"
+                      "INDEX 00 02:00:00\n"
+                      "FILE \"b.wav\" WAVE\n"
+                      "INDEX 01 00:00:00\n"
+                      "FILE \"b.wav\" WAVE\n"
+                      "TRACK 03 AUDIO\n"
+                      "INDEX 01 03:00:00\n";
+
+static char toc[] =   "CD_DA\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"a.wav\" 0 02:00:00\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"a.wav\" 02:00:00 01:00:00\n"
+                      "START 00:02:00\n"
+                      "TRACK AUDIO\n"
+                      "FILE \"a.wav\" 03:00:00\n";
+
+/* a.wav is 4 minutes, b.wav 5 */
+static long file_length(void *data, const char *name)
+{
+   if (!strcmp(name, "a.wav"))
+      return *(long *)data;
+   if (!strcmp(name, "b.wav"))
+      return MSF_TO_F(5,0,0);
+   return -1;
+}
+
+static int find(struct Timeline *timeline, long frame, int track, int index)
+{
+   int i = -1;
+
+   return timeline_find(timeline, frame, &i) == track && (!track || i == index);
+}
+
+static char* cue_test()
+{
+   struct Cd *cd = cue_parse_string(cue);
+   struct Timeline *timeline;
+   long length = MSF_TO_F(4,0,0);
+
+   mu_assert("error parsing CUE", cd != NULL);
+   timeline = cd_timeline(cd, NULL, NULL);
+   mu_assert("error building timeline", timeline != NULL);
+
+   mu_assert("invalid start of track 1", timeline_get_start(timeline, 1) == 0);
+   mu_assert("invalid start of track 2", timeline_get_start(timeline, 2) == MSF_TO_F(1,0,0));
+   mu_assert("invalid end of track 2", timeline_get_end(timeline, 2) == MSF_TO_F(2,0,0));
+   mu_assert("invalid zero pregap", timeline_get_index(timeline, 3, 0) == MSF_TO_F(2,0,0));
+   mu_assert("invalid index after pregap", timeline_get_index(timeline, 3, 1) == MSF_TO_F(2,2,0));
+   mu_assert("invalid index after postgap", timeline_get_index(timeline, 4, 1) == MSF_TO_F(3,3,0));
+   mu_assert("invalid index 02", timeline_get_index(timeline, 4, 2) == MSF_TO_F(3,33,0));
+   mu_assert("unset index", timeline_get_index(timeline, 1, 0) == -1 && timeline_get_start(timeline, 5) == -1);
+   mu_assert("end of disc known", timeline_get_length(timeline) == -1 && timeline_get_end(timeline, 4) == -1);
+
+   mu_assert("invalid track at 0", find(timeline, 0, 1, 1));
+   mu_assert("invalid track before pregap", find(timeline, MSF_TO_F(0,59,74), 1, 1));
+   mu_assert("invalid track in pregap", find(timeline, MSF_TO_F(1,0,0), 2, 0));
+   mu_assert("invalid track at index 01", find(timeline, MSF_TO_F(1,2,0), 2, 1));
+   mu_assert("invalid track in zero pregap", find(timeline, MSF_TO_F(2,1,74), 3, 0));
+   mu_assert("invalid track in postgap", find(timeline, MSF_TO_F(3,2,74), 3, 1));
+   mu_assert("invalid track at index 02", find(timeline, MSF_TO_F(10,0,0), 4, 2));
+   mu_assert("track before the disc", find(timeline, -1, 0, 0));
+   timeline_free(timeline);
+
+   /* the length of the file ends the disc */
+   timeline = cd_timeline(cd, file_length, &length);
+   mu_assert("error building timeline", timeline != NULL);
+   mu_assert("invalid end of disc", timeline_get_length(timeline) == MSF_TO_F(4,3,0));
+   mu_assert("invalid track at the end", find(timeline, MSF_TO_F(4,2,74), 4, 2));
+   mu_assert("track after the disc", find(timeline, MSF_TO_F(4,3,0), 0, 0));
+   timeline_free(timeline);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* files_test()
+{
+   struct Cd *cd = cue_parse_string(files);
+   struct Timeline *timeline;
+   long length = MSF_TO_F(2,2,0);
+
+   mu_assert("error parsing CUE", cd != NULL);
+   mu_assert("built without file length", !cd_timeline(cd, NULL, NULL));
+   timeline = cd_timeline(cd, file_length, &length);
+   mu_assert("error building timeline", timeline != NULL);
+   mu_assert("invalid pregap in the file before", timeline_get_start(timeline, 2) == MSF_TO_F(2,0,0));
+   mu_assert("invalid start of the second file", timeline_get_index(timeline, 2, 1) == MSF_TO_F(2,2,0));
+   mu_assert("invalid index in the second file", timeline_get_start(timeline, 3) == MSF_TO_F(5,2,0));
+   mu_assert("invalid end of disc", timeline_get_length(timeline) == MSF_TO_F(7,2,0));
+   mu_assert("invalid track in the pregap", find(timeline, MSF_TO_F(2,1,0), 2, 0));
+   mu_assert("invalid track in the second file", find(timeline, MSF_TO_F(6,0,0), 3, 1));
+   timeline_free(timeline);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* toc_test()
+{
+   struct Cd *cd = toc_parse_string(toc);
+   struct Timeline *timeline;
+   long length = MSF_TO_F(4,0,0);
+
+   mu_assert("error parsing TOC", cd != NULL);
+   timeline = cd_timeline(cd, NULL, NULL);
+   mu_assert("error building timeline", timeline != NULL);
+   mu_assert("invalid start of track 2", timeline_get_start(timeline, 2) == MSF_TO_F(2,0,0));
+   mu_assert("invalid index after START", timeline_get_index(timeline, 2, 1) == MSF_TO_F(2,2,0));
+   mu_assert("invalid start of track 3", timeline_get_start(timeline, 3) == MSF_TO_F(3,0,0));
+   mu_assert("end of disc known", timeline_get_length(timeline) == -1);
+   mu_assert("invalid track in pregap", find(timeline, MSF_TO_F(2,1,0), 2, 0));
+   timeline_free(timeline);
+
+   timeline = cd_timeline(cd, file_length, &length);
+   mu_assert("error building timeline", timeline != NULL);
+   mu_assert("invalid end of disc", timeline_get_length(timeline) == MSF_TO_F(4,0,0));
+   timeline_free(timeline);
+   cd_free(cd);
+   return NULL;
+}
+
+/* a chapter list: every frame is found in its chapter */
+static char* chapter_test()
+{
+   struct Parser *parser = parser_init();
+   struct Timeline *timeline;
+   struct Cd *cd;
+   char *buf = malloc(64 + NCHAPTER * 48), *p = buf;
+   long frame;
+   int i, nerror = 0;
+
+   mu_assert("error creating parser", parser != NULL && buf != NULL);
+   p += sprintf(p, "FILE book.wav WAVE\n");
+   for (i = 0; i < NCHAPTER; i++) {
+      frame = i * 750;
+      p += sprintf(p, "TRACK %02d AUDIO\nINDEX 01 %02ld:%02ld:%02ld\n", i + 1, frame / 4500, frame / 75 % 60, frame % 75);
+   }
+   parser_set_flag(parser, PARSE_EXTENDED);
+   cd = parser_cue_string(parser, buf);
+   parser_free(parser);
+   free(buf);
+   mu_assert("error parsing CUE", cd != NULL && cd_get_ntrack(cd) == NCHAPTER);
+
+   timeline = cd_timeline(cd, NULL, NULL);
+   mu_assert("error building timeline", timeline != NULL);
+   for (frame = 0; frame < NCHAPTER * 750L; frame += 7)
+      nerror += !find(timeline, frame, frame / 750 + 1, 1);
+   mu_assert("invalid chapter", !nerror);
+   timeline_free(timeline);
+   cd_free(cd);
+   return NULL;
+}
+
+static char* run_tests()
+{
+   mu_run_test (cue_test);
+   mu_run_test (files_test);
+   mu_run_test (toc_test);
+   mu_run_test (chapter_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "libcue.h"
+#include "minunit.h"
+
+int tests_run;
+
+/* Frames per second */
+#define FPS (75)
+#define MSF_TO_F(m,s,f) ((f) + ((m)*60 + (s))*FPS)
+
+static char toc[] =   "CD_DA\n"
+                      "CD_TEXT {\n"
+                      "  LANGUAGE_MAP { 0:9 }\n"
+                      "  LANGUAGE 0 {\n"
+                      "    TITLE \"Loveless\"\n"
+                      "    PERFORMER \"My Bloody Valentine\"\n"
+                      "  }\n"
+                      "}\n"
+                      "\n"
+                      "TRACK AUDIO\n"
+                      "CD_TEXT {\n"
+                      "  LANGUAGE 0 {\n"
+                      "    TITLE \"Only Shallow\"\n"
+                      "  }\n"
+                      "}\n"
+                      "FILE \"loveless.wav\" 0 04:17:52\n"
+                      "\n"
+                      "TRACK AUDIO\n"
+                      "CD_TEXT {\n"
+                      "  LANGUAGE 0 {\n"
+                      "    TITLE \"Loomer\"\n"
+                      "  }\n"
+                      "}\n"
+                      "FILE \"loveless.wav\" 04:17:52\n"
+                      "START 00:02:00\n";
+
+static char* toc_test(struct Parser *parser)
+{
+   struct Cd *cd = parser ? parser_toc_string(parser, toc) : toc_parse_string(toc);
+   mu_assert("error parsing TOC", cd != NULL);
+
+   const char *val = cdtext_get(cd_get_cdtext(cd), PTI_TITLE);
+   mu_assert("error validating CD title", val && !strcmp(val, "Loveless"));
+
+   mu_assert("invalid number of tracks", cd_get_ntrack(cd) == 2);
+
+   struct Track *track = cd_get_track(cd, 1);
+   val = track_get_filename(track);
+   mu_assert("error validating track filename", val && !strcmp(val, "loveless.wav"));
+   val = cdtext_get(track_get_cdtext(track), PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "Only Shallow"));
+   mu_assert("invalid track length", track_get_length(track) == MSF_TO_F(4,17,52));
+
+   track = cd_get_track(cd, 2);
+   val = cdtext_get(track_get_cdtext(track), PTI_TITLE);
+   mu_assert("error validating track title", val && !strcmp(val, "Loomer"));
+   mu_assert("invalid track start", track_get_start(track) == MSF_TO_F(4,17,52));
+   mu_assert("invalid index", track_get_index(track, 1) == MSF_TO_F(0,2,0));
+
+   cd_free(cd);
+
+   return NULL;
+}
+
+static char* string_test()
+{
+   return toc_test(NULL);
+}
+
+static char* reuse_test()
+{
+   struct Parser *parser = parser_init();
+   char *message = NULL;
+   int i;
+
+   mu_assert("error creating parser", parser != NULL);
+   for (i = 0; !message && i < 1000; i++)
+      message = toc_test(parser);
+   parser_free(parser);
+
+   return message;
+}
+
+static char* run_tests()
+{
+   mu_run_test (string_test);
+   mu_run_test (reuse_test);
+   return NULL;
+}
+
+int main (int argc, char **argv)
+{
+   char *result = run_tests();
+   if (result != NULL)
+      printf ("%s\n", result);
+   else
+      printf ("All tests passed!\n");
+
+   printf ("Tests run: %d\n", tests_run);
+
+   return result != NULL;
+}
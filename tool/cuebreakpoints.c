@@ -47,6 +47,7 @@ void usage(int status)
 		       "-m, --millisecond		print in m:ss.nnn (millisecond) instead of m:ss.ff (frame) format\n"
 		       "-p, --prepend-gaps		prefix pregaps to track\n"
 		       "-s, --split-gaps		split at beginning and end of pregaps\n"
+		       "-S, --stats			print parse statistics to stderr\n"
 		       "-V, --version			print version information\n");
 	} else
 		fprintf(stderr, "Try `%s --help' for more information.\n", progname);
@@ -129,7 +130,9 @@ int main(int argc, char *argv[])
 {
 	enum Format	format	= UNKNOWN;
 	enum GapMode	gaps	= APPEND;
-	bool		is_ms	= false;
+	bool		is_ms	= false,
+			stats	= false;
+	struct Stats	counters;
 	int ret = 0;		/* return value of breaks() */
 
 	/* option variables */
@@ -145,13 +148,14 @@ int main(int argc, char *argv[])
 		{"millisecond",		no_argument, NULL, 'm'},
 		{"prepend-gaps",	no_argument, NULL, 'p'},
 		{"split-gaps",		no_argument, NULL, 's'},
+		{"stats",		no_argument, NULL, 'S'},
 		{"version",		no_argument, NULL, 'V'},
 		{NULL, 0, NULL, 0}
 	};
 
 	progname = argv[0];
 
-	while (-1 != (c = getopt_long(argc, argv, "hi:lmpsV", longopts, NULL))) {
+	while (-1 != (c = getopt_long(argc, argv, "hi:lmpsSV", longopts, NULL))) {
 		switch (c) {
 		case 'h':
 			usage(0);
@@ -179,6 +183,9 @@ int main(int argc, char *argv[])
 		case 's':
 			gaps = SPLIT;
 			break;
+		case 'S':
+			stats = true;
+			break;
 		case 'V':
 			version();
 			break;
@@ -188,6 +195,8 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	cue_stats_enable(stats);
+
 	/* What we do depends on the number of operands. */
 	if (optind == argc)
 		/* No operands: report breakpoints of stdin. */
@@ -201,5 +210,10 @@ int main(int argc, char *argv[])
 				break;
 		}
 
+	if (stats) {
+		cue_stats_get(&counters);
+		cue_stats_print(stderr, &counters);
+	}
+
 	return ret;
 }
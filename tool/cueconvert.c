@@ -31,6 +31,7 @@ void usage(int status)
 		       "-h, --help			print usage\n"
 		       "-i, --input-format cue|toc	set format of input file\n"
 		       "-o, --output-format cue|toc	set format of output file\n"
+		       "-S, --stats			print parse and print statistics to stderr\n"
 		       "-V, --version			print version information\n");
 	} else
 		fprintf(stderr, "Try `%s --help' for more information.\n", progname);
@@ -77,6 +78,8 @@ int main(int argc, char *argv[])
 	enum Format	iformat = UNKNOWN,
 				oformat = UNKNOWN;
 	int ret = 0;		/* return value of convert() */
+	int stats = 0;		/* print statistics */
+	struct Stats counters;
 
 	/* option variables */
 	int c;
@@ -88,13 +91,14 @@ int main(int argc, char *argv[])
 		{"help", no_argument, NULL, 'h'},
 		{"input-format", required_argument, NULL, 'i'},
 		{"output-format", required_argument, NULL, 'o'},
+		{"stats", no_argument, NULL, 'S'},
 		{"version", no_argument, NULL, 'V'},
 		{NULL, 0, NULL, 0}
 	};
 
 	progname = argv[0];
 
-	while (-1 != (c = getopt_long(argc, argv, "hi:o:V", longopts, NULL)))
+	while (-1 != (c = getopt_long(argc, argv, "hi:o:SV", longopts, NULL)))
 		switch (c) {
 		case 'h':
 			usage(0);
@@ -121,6 +125,9 @@ int main(int argc, char *argv[])
 				usage(1);
 			}
 			break;
+		case 'S':
+			stats = 1;
+			break;
 		case 'V':
 			version();
 			break;
@@ -129,6 +136,8 @@ int main(int argc, char *argv[])
 			break;
 		}
 
+	cue_stats_enable(stats);
+
 	/* What we do depends on the number of operands. */
 	if (optind == argc)
 		/* No operands: report breakpoints of stdin. */
@@ -142,5 +151,10 @@ int main(int argc, char *argv[])
 	else
 		usage(1);
 
+	if (stats) {
+		cue_stats_get(&counters);
+		cue_stats_print(stderr, &counters);
+	}
+
 	return ret;
 }
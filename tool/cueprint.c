@@ -75,6 +75,7 @@ void usage(int status)
 		       "-n, --track-number <number>	only print track information for single track\n"
 		       "-d, --disc-template <template>	set disc template\n"
 		       "-t, --track-template <template>	set track template\n"
+		       "-S, --stats			print parse statistics to stderr\n"
 		       "-V, --version			print version information\n"
 		       "\n"
 		       "Default disc template: %s\n"
@@ -233,13 +234,15 @@ void track_field(char *conv, int length, struct Cd *cd, int trackno, union Value
  */
 void print_conv(char *start, int length, struct Cd *cd, int trackno)
 {
+	char buf[32];	/* holds any sensible specification */
 	char *conv;	/* copy of conversion specification */
 	union Value value;
 	char *c;	/* pointer to conversion-char */
 
-	/* TODO: use strndup? */
-	conv = malloc((unsigned) (length + 1));
-	strncpy(conv, start, length);
+	conv = length < (int) sizeof(buf) ? buf : malloc((unsigned) (length + 1));
+	if (!conv)
+		return;
+	memcpy(conv, start, length);
 	conv[length] = '\0';
 
 	/* conversion character */
@@ -268,63 +271,91 @@ void print_conv(char *start, int length, struct Cd *cd, int trackno)
 		printf("%s", conv);
 	}
 
-	free(conv);
+	if (conv != buf)
+		free(conv);
 }
 
-void cd_printf(char *template, struct Cd *cd, int trackno)
+/*
+ * Skip a conversion specification from its '%' at c.
+ * Returns a pointer to the conversion character.
+ */
+char *conv_skip(char *c)
 {
-	char *c;	/* pointer into template */
-	char *conv_start;
-	int conv_length;
+	c++;
 
-	for (c = template; '\0' != *c; c++) {
-		if ('%' == *c) {
-			conv_start = c;
-			conv_length = 1;
-			c++;
+	/* flags */
+	while ('-' == *c || '+' == *c || ' ' == *c || '0' == *c || '#' == *c)
+		c++;
 
-			/* flags */
-			while ('-' == *c || '+' == *c || ' ' == *c || '0' == *c || '#' == *c) {
-				conv_length++;
-				c++;
-			}
+	/* field width */
+	/* '*' not recognized */
+	while (0 != isdigit(*c))
+		c++;
 
-			/* field width */
-			/* '*' not recognized */
-			while (0 != isdigit(*c)) {
-				conv_length++;
-				c++;
-			}
+	/* precision */
+	/* '*' not recognized */
+	if ('.' == *c) {
+		c++;
 
-			/* precision */
-			/* '*' not recognized */
-			if ('.' == *c) {
-				conv_length++;
-				c++;
+		while (0 != isdigit(*c))
+			c++;
+	}
 
-				while (0 != isdigit(*c)) {
-					conv_length++;
-					c++;
-				}
-			}
+	/* length modifier (h, l, or L) */
+	/* not recognized */
 
-			/* length modifier (h, l, or L) */
-			/* not recognized */
+	return c;
+}
 
-			/* conversion character */
-			conv_length++;
+void cd_printf(char *template, struct Cd *cd, int trackno)
+{
+	char *c;	/* pointer into template */
+	char *conv_start;
 
-			print_conv(conv_start, conv_length, cd, trackno);
+	for (c = template; '\0' != *c; c++) {
+		if ('%' == *c) {
+			conv_start = c;
+			c = conv_skip(c);
+			print_conv(conv_start, c - conv_start + 1, cd, trackno);
 		} else
 			putchar(*c);
 	}
 }
 
+/*
+ * Last track to parse for printing template for trackno, -1 for all.
+ * Only %N needs the tracks after it.
+ */
+int last_track(char *template, int trackno)
+{
+	char *c;
+
+	if (-1 == trackno)
+		return -1;
+	for (c = template; '\0' != *c; c++) {
+		if ('%' != *c)
+			continue;
+		c = conv_skip(c);
+		if ('N' == *c)
+			return -1;
+		if ('\0' == *c)
+			break;
+	}
+	return trackno;
+}
+
 int info(char *name, enum Format format, int trackno, char *d_template, char *t_template)
 {
-	struct Cd *cd = cf_parse(name, &format);
+	struct Parser *parser = parser_init();
+	struct Cd *cd = NULL;
 	int ntrack;
 
+	if (parser) {
+		parser_set_last_track(parser, last_track(trackno ? t_template : d_template, trackno));
+		cd = parser_cf_parse(parser, name, &format);
+		parser_free(parser);
+	}
+
 	if (!cd) {
 		fprintf(stderr, "%s: error: unable to parse input file"
 		        " `%s'\n", progname, name);
@@ -387,7 +418,9 @@ int main(int argc, char *argv[])
 {
 	enum Format	format		= UNKNOWN;
 	int		trackno		= -1,	// track number (-1 = unspecified, 0 = disc info)
-			ret		= 0;	// return value of info()
+			ret		= 0,	// return value of info()
+			stats		= 0;	// print statistics
+	struct Stats	counters;
 	char		*d_template	= NULL,	// disc template
 			*t_template	= NULL;	// track template
 
@@ -403,13 +436,14 @@ int main(int argc, char *argv[])
 		{"track-number",	required_argument,	NULL, 'n'},
 		{"disc-template",	required_argument,	NULL, 'd'},
 		{"track-template",	required_argument,	NULL, 't'},
+		{"stats",		no_argument,		NULL, 'S'},
 		{"version",		no_argument,		NULL, 'V'},
 		{NULL, 0, NULL, 0}
 	};
 
 	progname = argv[0];
 
-	while (-1 != (c = getopt_long(argc, argv, "hi:n:d:t:V", longopts, NULL))) {
+	while (-1 != (c = getopt_long(argc, argv, "hi:n:d:t:SV", longopts, NULL))) {
 		switch (c) {
 		case 'h':
 			usage(0);
@@ -434,6 +468,9 @@ int main(int argc, char *argv[])
 		case 't':
 			t_template = optarg;
 			break;
+		case 'S':
+			stats = 1;
+			break;
 		case 'V':
 			version();
 			break;
@@ -458,6 +495,8 @@ int main(int argc, char *argv[])
 	translate_escapes(d_template);
 	translate_escapes(t_template);
 
+	cue_stats_enable(stats);
+
 	/* What we do depends on the number of operands. */
 	if (optind == argc)
 		/* No operands: report information about stdin. */
@@ -471,5 +510,10 @@ int main(int argc, char *argv[])
 				break;
 		}
 
+	if (stats) {
+		cue_stats_get(&counters);
+		cue_stats_print(stderr, &counters);
+	}
+
 	return ret;
 }